@@ -0,0 +1,221 @@
+#include "harness.h"
+#include "custom_vector.h"
+#include "recycling_allocator.h"
+#include "incremental_vector.h"
+#include "sort.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+
+constexpr std::size_t large = std::size_t(1) << 22;
+constexpr std::size_t small = std::size_t(1) << 12;
+
+void growth_benchmarks(ctm::bench::harness& h)
+{
+    h.run("vector/push_back/grow", large, []()
+    {
+        ctm::vector<int> vec;
+
+        for (std::size_t i = 0; i < large; ++i)
+        {
+            vec.push_back(static_cast<int>(i));
+        }
+        ctm::bench::do_not_optimize(vec.data());
+    });
+
+    h.run("vector/push_back/reserved", large, []()
+    {
+        ctm::vector<int> vec;
+        vec.reserve(large);
+
+        for (std::size_t i = 0; i < large; ++i)
+        {
+            vec.push_back(static_cast<int>(i));
+        }
+        ctm::bench::do_not_optimize(vec.data());
+    });
+
+    h.run("vector/append_n", large, []()
+    {
+        ctm::vector<int> vec;
+        int next = 0;
+        vec.append_n(large, [&next]() { return next++; });
+        ctm::bench::do_not_optimize(vec.data());
+    });
+
+    h.run("vector/push_back_unchecked/reserved", large, []()
+    {
+        ctm::vector<int> vec;
+        vec.reserve(large);
+
+        for (std::size_t i = 0; i < large; ++i)
+        {
+            vec.push_back_unchecked(static_cast<int>(i));
+        }
+        ctm::bench::do_not_optimize(vec.data());
+    });
+
+    h.run("vector/push_back/recycling_allocator", large, []()
+    {
+        ctm::recycling_vector<int> vec;
+
+        for (std::size_t i = 0; i < large; ++i)
+        {
+            vec.push_back(static_cast<int>(i));
+        }
+        ctm::bench::do_not_optimize(vec.data());
+    });
+
+    h.run("incremental_vector/push_back/grow", large, []()
+    {
+        ctm::incremental_vector<int> vec;
+
+        for (std::size_t i = 0; i < large; ++i)
+        {
+            vec.push_back(static_cast<int>(i));
+        }
+        ctm::bench::do_not_optimize(vec.back());
+    });
+
+    h.run("std::vector/push_back/grow", large, []()
+    {
+        std::vector<int> vec;
+
+        for (std::size_t i = 0; i < large; ++i)
+        {
+            vec.push_back(static_cast<int>(i));
+        }
+        ctm::bench::do_not_optimize(vec.data());
+    });
+}
+
+void bulk_benchmarks(ctm::bench::harness& h)
+{
+    h.run("vector/fill_construct", large, []()
+    {
+        ctm::vector<int> vec(large, 7);
+        ctm::bench::do_not_optimize(vec.data());
+    });
+
+    h.run("vector/copy_construct", large,
+        []() { return ctm::vector<int>(large, 1); },
+        [](ctm::vector<int>& source)
+        {
+            ctm::vector<int> copy(source);
+            ctm::bench::do_not_optimize(copy.data());
+        });
+
+    h.run("vector/sequential_sum", large,
+        []()
+        {
+            ctm::vector<int> vec(large, 0);
+            std::iota(vec.begin(), vec.end(), 0);
+            return vec;
+        },
+        [](ctm::vector<int>& vec)
+        {
+            long long sum = std::accumulate(vec.begin(), vec.end(), 0LL);
+            ctm::bench::do_not_optimize(sum);
+        });
+}
+
+void modifier_benchmarks(ctm::bench::harness& h)
+{
+    h.run("vector/insert_front", small, []()
+    {
+        ctm::vector<int> vec;
+
+        for (std::size_t i = 0; i < small; ++i)
+        {
+            vec.insert(vec.begin(), static_cast<int>(i));
+        }
+        ctm::bench::do_not_optimize(vec.data());
+    });
+
+    h.run("vector/erase_if/half", large,
+        []()
+        {
+            ctm::vector<int> vec(large, 0);
+            std::iota(vec.begin(), vec.end(), 0);
+            return vec;
+        },
+        [](ctm::vector<int>& vec)
+        {
+            ctm::erase_if(vec, [](int x) { return (x & 1) != 0; });
+            ctm::bench::do_not_optimize(vec.data());
+        });
+
+    h.run("vector/erase_unordered_if/half", large,
+        []()
+        {
+            ctm::vector<int> vec(large, 0);
+            std::iota(vec.begin(), vec.end(), 0);
+            return vec;
+        },
+        [](ctm::vector<int>& vec)
+        {
+            vec.erase_unordered_if([](int x) { return (x & 1) != 0; });
+            ctm::bench::do_not_optimize(vec.data());
+        });
+}
+
+template <typename T>
+ctm::vector<T> random_values(std::size_t n)
+{
+    ctm::vector<T> values;
+    values.reserve(n);
+    std::uint64_t state = 88172645463325252ULL;
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        values.push_back(static_cast<T>(state));
+    }
+    return values;
+}
+
+void sort_benchmarks(ctm::bench::harness& h)
+{
+    h.run("sort/uint64/ctm::sort", large,
+        []() { return random_values<std::uint64_t>(large); },
+        [](ctm::vector<std::uint64_t>& vec) { ctm::sort(vec); });
+
+    h.run("sort/uint64/std::sort", large,
+        []() { return random_values<std::uint64_t>(large); },
+        [](ctm::vector<std::uint64_t>& vec) { std::sort(vec.begin(), vec.end()); });
+
+    h.run("sort/double/ctm::sort", large,
+        []() { return random_values<double>(large); },
+        [](ctm::vector<double>& vec) { ctm::sort(vec); });
+
+    h.run("sort/double/std::sort", large,
+        []() { return random_values<double>(large); },
+        [](ctm::vector<double>& vec) { std::sort(vec.begin(), vec.end()); });
+
+    h.run("sort/uint64/ctm::sort/comparator", large,
+        []() { return random_values<std::uint64_t>(large); },
+        [](ctm::vector<std::uint64_t>& vec) { ctm::sort(vec, std::greater<>()); });
+
+    h.run("sort/uint64/std::sort/comparator", large,
+        []() { return random_values<std::uint64_t>(large); },
+        [](ctm::vector<std::uint64_t>& vec) { std::sort(vec.begin(), vec.end(), std::greater<>()); });
+}
+
+};
+
+int main(int argc, char** argv)
+{
+    ctm::bench::harness h(argc, argv);
+    growth_benchmarks(h);
+    bulk_benchmarks(h);
+    modifier_benchmarks(h);
+    sort_benchmarks(h);
+    return h.finish();
+}
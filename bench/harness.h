@@ -0,0 +1,222 @@
+#pragma once
+
+#include "perf_counters.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace ctm
+{
+
+namespace bench
+{
+
+// Keeps the compiler from discarding a result that is never read.
+template <typename T>
+inline void do_not_optimize(const T& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+struct result
+{
+    std::string name;
+    std::size_t operations;
+    std::size_t repetitions;
+    double ns_per_op;           // fastest repetition
+    double median_ns_per_op;
+    counter_sample per_op;      // from the fastest repetition
+};
+
+// Minimal microbenchmark runner. Each benchmark body performs a known
+// number of operations; it is repeated, timed, and measured with
+// perf_counters, and the results are written as JSON.
+//
+// Options: --filter <substring>, --repetitions <n>, --out <file.json>.
+class harness
+{
+public:
+    harness(int argc, char** argv):
+        filter_(),
+        out_path_(),
+        repetitions_(5)
+    {
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            const std::string option = argv[i];
+
+            if (option == "--filter")
+            {
+                filter_ = argv[i + 1];
+            }
+            else if (option == "--repetitions")
+            {
+                repetitions_ = std::max(1, std::stoi(argv[i + 1]));
+            }
+            else if (option == "--out")
+            {
+                out_path_ = argv[i + 1];
+            }
+        }
+
+        if (!counters_.any_available())
+        {
+            std::cerr << "note: hardware counters unavailable, reporting wall time only\n";
+        }
+    }
+
+    // setup() builds the input outside the measured region and its result
+    // is passed to body(), which must perform `operations` operations.
+    template <typename Setup, typename Body>
+    void run(const std::string& name, std::size_t operations, Setup setup, Body body)
+    {
+        if (!filter_.empty() && name.find(filter_) == std::string::npos)
+        {
+            return;
+        }
+
+        std::vector<double> times;
+        counter_sample best_counters;
+        double best = -1.0;
+
+        for (int rep = 0; rep < repetitions_; ++rep)
+        {
+            auto state = setup();
+            counters_.start();
+            const auto start = std::chrono::steady_clock::now();
+            body(state);
+            const auto stop = std::chrono::steady_clock::now();
+            const counter_sample sample = counters_.stop();
+
+            const double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+            times.push_back(ns);
+
+            if (best < 0.0 || ns < best)
+            {
+                best = ns;
+                best_counters = sample;
+            }
+        }
+
+        std::sort(times.begin(), times.end());
+        const double ops = static_cast<double>(std::max<std::size_t>(operations, 1));
+
+        for (double& value : best_counters.value)
+        {
+            value /= ops;
+        }
+
+        results_.push_back(result{name, operations, static_cast<std::size_t>(repetitions_),
+                                  best / ops, times[times.size() / 2] / ops, best_counters});
+        print(results_.back());
+    }
+
+    template <typename Body>
+    void run(const std::string& name, std::size_t operations, Body body)
+    {
+        run(name, operations, []() { return 0; }, [&body](int&) { body(); });
+    }
+
+    const std::vector<result>& results() const
+    {
+        return results_;
+    }
+
+    void write_json(std::ostream& os) const
+    {
+        os << "{\n  \"context\": {\"repetitions\": " << repetitions_ << ", \"counters\": {";
+
+        for (std::size_t i = 0; i < counter_count; ++i)
+        {
+            os << (i == 0 ? "" : ", ") << "\"" << counter_names[i] << "\": "
+               << (counters_.available(static_cast<counter>(i)) ? "true" : "false");
+        }
+        os << "}},\n  \"benchmarks\": [";
+
+        for (std::size_t r = 0; r < results_.size(); ++r)
+        {
+            const result& res = results_[r];
+            os << (r == 0 ? "" : ",") << "\n    {\"name\": \"" << res.name << "\""
+               << ", \"operations\": " << res.operations
+               << ", \"repetitions\": " << res.repetitions
+               << ", \"ns_per_op\": " << res.ns_per_op
+               << ", \"median_ns_per_op\": " << res.median_ns_per_op
+               << ", \"counters_per_op\": {";
+
+            for (std::size_t i = 0; i < counter_count; ++i)
+            {
+                os << (i == 0 ? "" : ", ") << "\"" << counter_names[i] << "\": ";
+
+                if (res.per_op.available[i])
+                {
+                    os << res.per_op.value[i];
+                }
+                else
+                {
+                    os << "null";
+                }
+            }
+            os << "}}";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+    // Writes the JSON report to --out, or to stdout. Returns an exit code.
+    int finish() const
+    {
+        if (out_path_.empty())
+        {
+            write_json(std::cout);
+            return 0;
+        }
+
+        std::ofstream file(out_path_);
+
+        if (!file)
+        {
+            std::cerr << "cannot open " << out_path_ << "\n";
+            return 1;
+        }
+        write_json(file);
+        return 0;
+    }
+
+private:
+    std::string filter_;
+    std::string out_path_;
+    int repetitions_;
+    perf_counters counters_;
+    std::vector<result> results_;
+
+    static void print(const result& res)
+    {
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-40s %10.2f ns/op", res.name.c_str(), res.ns_per_op);
+        std::cerr << line;
+
+        for (counter c : {counter::cycles, counter::instructions, counter::cache_misses, counter::dtlb_misses})
+        {
+            const std::size_t i = static_cast<std::size_t>(c);
+
+            if (res.per_op.available[i])
+            {
+                std::snprintf(line, sizeof(line), "  %s %.2f", counter_names[i], res.per_op.value[i]);
+                std::cerr << line;
+            }
+        }
+        std::cerr << "\n";
+    }
+};
+
+};
+
+};
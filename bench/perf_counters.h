@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ctm
+{
+
+namespace bench
+{
+
+enum class counter
+{
+    cycles,
+    instructions,
+    cache_misses,
+    dtlb_misses,
+    branch_misses,
+    page_faults
+};
+
+inline constexpr std::size_t counter_count = 6;
+
+inline constexpr std::array<const char*, counter_count> counter_names{
+    "cycles", "instructions", "cache_misses", "dtlb_misses", "branch_misses", "page_faults"};
+
+// Counter totals over one measured region. A counter the kernel refused to
+// open (no PMU in a container, perf_event_paranoid, non-Linux) is marked
+// unavailable instead of failing the run.
+struct counter_sample
+{
+    std::array<bool, counter_count> available{};
+    std::array<double, counter_count> value{};
+
+    double operator[](counter c) const
+    {
+        return value[static_cast<std::size_t>(c)];
+    }
+};
+
+// Hardware and software counters for the calling thread, read through
+// perf_event_open. Every counter is opened on its own so that one missing
+// event does not disable the rest; values are scaled when the kernel had to
+// multiplex them.
+class perf_counters
+{
+public:
+    perf_counters()
+    {
+        fds_.fill(-1);
+#if defined(__linux__)
+        open(counter::cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open(counter::instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open(counter::cache_misses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        open(counter::dtlb_misses, PERF_TYPE_HW_CACHE,
+             PERF_COUNT_HW_CACHE_DTLB |
+             (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        open(counter::branch_misses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        open(counter::page_faults, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+#endif
+    }
+
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    ~perf_counters()
+    {
+#if defined(__linux__)
+        for (int fd : fds_)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    bool available(counter c) const
+    {
+        return fds_[static_cast<std::size_t>(c)] >= 0;
+    }
+
+    bool any_available() const
+    {
+        for (int fd : fds_)
+        {
+            if (fd >= 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void start()
+    {
+#if defined(__linux__)
+        for (int fd : fds_)
+        {
+            if (fd >= 0)
+            {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    counter_sample stop()
+    {
+        counter_sample sample;
+#if defined(__linux__)
+        for (int fd : fds_)
+        {
+            if (fd >= 0)
+            {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+
+        for (std::size_t i = 0; i < counter_count; ++i)
+        {
+            // value, time enabled, time running
+            std::uint64_t data[3] = {};
+
+            if (fds_[i] < 0 || read(fds_[i], data, sizeof(data)) != sizeof(data))
+            {
+                continue;
+            }
+
+            sample.available[i] = true;
+            sample.value[i] = data[2] == 0 ? 0.0 :
+                static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]);
+        }
+#endif
+        return sample;
+    }
+
+private:
+    std::array<int, counter_count> fds_;
+
+#if defined(__linux__)
+    void open(counter c, std::uint32_t type, std::uint64_t config)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        const long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        fds_[static_cast<std::size_t>(c)] = static_cast<int>(fd);
+    }
+#endif
+};
+
+};
+
+};
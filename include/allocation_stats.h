@@ -0,0 +1,324 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <thread>
+
+namespace ctm
+{
+
+// Snapshot of the allocation counters recorded by ctm::allocator when the
+// library is built with CTM_ALLOCATOR_STATS.
+struct allocation_stats
+{
+    // size class k counts requests of (2^(k-1), 2^k] bytes; the last class
+    // collects everything larger
+    static constexpr std::size_t size_classes = 40;
+
+    std::uint64_t allocations = 0;
+    std::uint64_t deallocations = 0;
+    std::uint64_t bytes_allocated = 0;
+    std::uint64_t bytes_deallocated = 0;
+    std::uint64_t live_bytes = 0;
+    std::uint64_t peak_bytes = 0;
+    std::array<std::uint64_t, size_classes> histogram{};
+
+    static std::size_t size_class(std::size_t bytes)
+    {
+        const std::size_t k = bytes <= 1 ? 0 : std::bit_width(bytes - 1);
+        return std::min(k, size_classes - 1);
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const allocation_stats& stats)
+{
+    os << "allocations=" << stats.allocations
+       << " deallocations=" << stats.deallocations
+       << " bytes_allocated=" << stats.bytes_allocated
+       << " bytes_deallocated=" << stats.bytes_deallocated
+       << " live_bytes=" << stats.live_bytes
+       << " peak_bytes=" << stats.peak_bytes
+       << " histogram=[";
+
+    bool first = true;
+
+    for (std::size_t k = 0; k < allocation_stats::size_classes; ++k)
+    {
+        if (stats.histogram[k] == 0)
+        {
+            continue;
+        }
+
+        os << (first ? "" : " ") << "<=" << (std::uint64_t(1) << k) << ":" << stats.histogram[k];
+        first = false;
+    }
+    return os << "]";
+}
+
+namespace detail
+{
+
+// Counters owned by a single thread. Only the owner writes them, so updates
+// are a plain load/store pair rather than a locked read-modify-write; the
+// atomics only make concurrent reads from get_allocation_stats() defined.
+struct thread_allocation_counters
+{
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> deallocations{0};
+    std::atomic<std::uint64_t> bytes_allocated{0};
+    std::atomic<std::uint64_t> bytes_deallocated{0};
+    std::array<std::atomic<std::uint64_t>, allocation_stats::size_classes> histogram{};
+
+    // live-byte change not yet folded into the shared peak tracker
+    std::int64_t unpublished_live = 0;
+
+    static void bump(std::atomic<std::uint64_t>& counter, std::uint64_t amount)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + amount,
+                      std::memory_order_relaxed);
+    }
+
+    void add_to(allocation_stats& stats) const
+    {
+        stats.allocations += allocations.load(std::memory_order_relaxed);
+        stats.deallocations += deallocations.load(std::memory_order_relaxed);
+        stats.bytes_allocated += bytes_allocated.load(std::memory_order_relaxed);
+        stats.bytes_deallocated += bytes_deallocated.load(std::memory_order_relaxed);
+
+        for (std::size_t k = 0; k < allocation_stats::size_classes; ++k)
+        {
+            stats.histogram[k] += histogram[k].load(std::memory_order_relaxed);
+        }
+    }
+};
+
+class allocation_registry
+{
+public:
+    // Live-byte changes are published to the shared counter in batches of
+    // this size, so peak_bytes is exact to within one batch per thread.
+    static constexpr std::int64_t publish_threshold = 64 * 1024;
+
+    static allocation_registry& instance()
+    {
+        static allocation_registry registry;
+        return registry;
+    }
+
+    thread_allocation_counters* attach()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return &threads_.emplace_back();
+    }
+
+    // Folds an exiting thread's counters into the retired totals.
+    void detach(thread_allocation_counters* counters)
+    {
+        publish_live(counters->unpublished_live);
+        counters->unpublished_live = 0;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        counters->add_to(retired_);
+
+        for (auto it = threads_.begin(); it != threads_.end(); ++it)
+        {
+            if (&*it == counters)
+            {
+                threads_.erase(it);
+                break;
+            }
+        }
+    }
+
+    void publish_live(std::int64_t delta)
+    {
+        const std::int64_t live = live_.fetch_add(delta, std::memory_order_relaxed) + delta;
+
+        if (live <= 0)
+        {
+            return;
+        }
+
+        std::uint64_t peak = peak_.load(std::memory_order_relaxed);
+
+        while (static_cast<std::uint64_t>(live) > peak &&
+               !peak_.compare_exchange_weak(peak, static_cast<std::uint64_t>(live),
+                                            std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // Slow path for threads that are already tearing down their counters.
+    void record_detached(std::size_t bytes, bool allocation)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (allocation)
+            {
+                ++retired_.allocations;
+                retired_.bytes_allocated += bytes;
+                ++retired_.histogram[allocation_stats::size_class(bytes)];
+            }
+            else
+            {
+                ++retired_.deallocations;
+                retired_.bytes_deallocated += bytes;
+            }
+        }
+        publish_live(allocation ? static_cast<std::int64_t>(bytes) : -static_cast<std::int64_t>(bytes));
+    }
+
+    allocation_stats snapshot()
+    {
+        allocation_stats stats;
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats = retired_;
+
+        for (const thread_allocation_counters& counters : threads_)
+        {
+            counters.add_to(stats);
+        }
+
+        stats.live_bytes = stats.bytes_allocated - stats.bytes_deallocated;
+        stats.peak_bytes = std::max(peak_.load(std::memory_order_relaxed), stats.live_bytes);
+        return stats;
+    }
+
+private:
+    std::mutex mutex_;
+    std::list<thread_allocation_counters> threads_;
+    allocation_stats retired_;
+    std::atomic<std::int64_t> live_{0};
+    std::atomic<std::uint64_t> peak_{0};
+};
+
+// Plain thread_locals so that deallocations during static destruction,
+// after the guard below has run, still find a valid (null) pointer.
+inline thread_local thread_allocation_counters* local_counters = nullptr;
+inline thread_local bool local_counters_detached = false;
+
+struct thread_allocation_guard
+{
+    ~thread_allocation_guard()
+    {
+        allocation_registry::instance().detach(local_counters);
+        local_counters = nullptr;
+        local_counters_detached = true;
+    }
+};
+
+// Returns nullptr once the calling thread has started exiting.
+inline thread_allocation_counters* local_allocation_counters()
+{
+    if (local_counters == nullptr && !local_counters_detached)
+    {
+        local_counters = allocation_registry::instance().attach();
+        thread_local thread_allocation_guard guard;
+    }
+    return local_counters;
+}
+
+inline void record_live_change(thread_allocation_counters& counters, std::int64_t delta)
+{
+    counters.unpublished_live += delta;
+
+    if (counters.unpublished_live >= allocation_registry::publish_threshold ||
+        counters.unpublished_live <= -allocation_registry::publish_threshold)
+    {
+        allocation_registry::instance().publish_live(counters.unpublished_live);
+        counters.unpublished_live = 0;
+    }
+}
+
+inline void record_allocation(std::size_t bytes)
+{
+    thread_allocation_counters* counters = local_allocation_counters();
+
+    if (counters == nullptr)
+    {
+        allocation_registry::instance().record_detached(bytes, true);
+        return;
+    }
+
+    thread_allocation_counters::bump(counters->allocations, 1);
+    thread_allocation_counters::bump(counters->bytes_allocated, bytes);
+    thread_allocation_counters::bump(counters->histogram[allocation_stats::size_class(bytes)], 1);
+    record_live_change(*counters, static_cast<std::int64_t>(bytes));
+}
+
+inline void record_deallocation(std::size_t bytes)
+{
+    thread_allocation_counters* counters = local_allocation_counters();
+
+    if (counters == nullptr)
+    {
+        allocation_registry::instance().record_detached(bytes, false);
+        return;
+    }
+
+    thread_allocation_counters::bump(counters->deallocations, 1);
+    thread_allocation_counters::bump(counters->bytes_deallocated, bytes);
+    record_live_change(*counters, -static_cast<std::int64_t>(bytes));
+}
+
+};
+
+// Aggregates the per-thread counters of every thread, including threads
+// that have already exited.
+inline allocation_stats get_allocation_stats()
+{
+    return detail::allocation_registry::instance().snapshot();
+}
+
+// Writes get_allocation_stats() to a stream every interval until destroyed.
+class allocation_stats_dumper
+{
+public:
+    explicit allocation_stats_dumper(std::chrono::milliseconds interval,
+                                     std::ostream& os = std::cerr):
+        interval_(interval),
+        os_(os),
+        stop_(false),
+        thread_([this]() { run(); }) {}
+
+    allocation_stats_dumper(const allocation_stats_dumper&) = delete;
+    allocation_stats_dumper& operator=(const allocation_stats_dumper&) = delete;
+
+    ~allocation_stats_dumper()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+private:
+    std::chrono::milliseconds interval_;
+    std::ostream& os_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_;
+    std::thread thread_;
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (!cv_.wait_for(lock, interval_, [this]() { return stop_; }))
+        {
+            os_ << "[ctm::allocator] " << get_allocation_stats() << std::endl;
+        }
+    }
+};
+
+};
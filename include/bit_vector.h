@@ -0,0 +1,629 @@
+#pragma once
+
+#include "custom_vector.h"
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace ctm
+{
+
+// Dynamic array of bits packed into 64-bit words. Bits past size() in the
+// last word are always kept at zero so that count() and the word-level
+// operations never need to mask the tail.
+class bit_vector
+{
+public:
+    using word_type = std::uint64_t;
+    using size_type = std::size_t;
+
+    static constexpr size_type bits_per_word = 64;
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    class reference
+    {
+    public:
+        reference(word_type* word, word_type mask):
+            word_(word),
+            mask_(mask) {}
+
+        reference(const reference& other) = default;
+
+        operator bool() const
+        {
+            return (*word_ & mask_) != 0;
+        }
+
+        reference& operator=(bool value)
+        {
+            if (value)
+            {
+                *word_ |= mask_;
+            }
+            else
+            {
+                *word_ &= ~mask_;
+            }
+            return *this;
+        }
+
+        reference& operator=(const reference& other)
+        {
+            return *this = static_cast<bool>(other);
+        }
+
+        bool operator~() const
+        {
+            return !static_cast<bool>(*this);
+        }
+
+        reference& flip()
+        {
+            *word_ ^= mask_;
+            return *this;
+        }
+
+    private:
+        word_type* word_;
+        word_type mask_;
+    };
+
+    bit_vector():
+        words_(),
+        size_(0) {}
+
+    explicit bit_vector(size_type count, bool value = false):
+        words_(),
+        size_(0)
+    {
+        resize(count, value);
+    }
+
+    bit_vector(std::initializer_list<bool> init):
+        words_(),
+        size_(0)
+    {
+        reserve(init.size());
+
+        for (bool value : init)
+        {
+            push_back(value);
+        }
+    }
+
+    // ELEMENT ACCESS
+    bool operator[](size_type index) const
+    {
+        return (words_[word_index(index)] & bit_mask(index)) != 0;
+    }
+
+    reference operator[](size_type index)
+    {
+        return reference(&words_[word_index(index)], bit_mask(index));
+    }
+
+    bool test(size_type index) const
+    {
+        if (index >= size_)
+        {
+            throw std::out_of_range("Indexing out of range");
+        }
+        return (*this)[index];
+    }
+
+    bool front() const
+    {
+        return (*this)[0];
+    }
+
+    bool back() const
+    {
+        return (*this)[size_ - 1];
+    }
+
+    word_type* data()
+    {
+        return words_.data();
+    }
+
+    const word_type* data() const
+    {
+        return words_.data();
+    }
+
+    size_type num_words() const
+    {
+        return words_.size();
+    }
+
+    // CAPACITY
+    bool empty() const
+    {
+        return (size_ == 0);
+    }
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+    size_type capacity() const
+    {
+        return words_.capacity() * bits_per_word;
+    }
+
+    void reserve(size_type new_capacity)
+    {
+        words_.reserve(words_for(new_capacity));
+    }
+
+    // MODIFIERS
+    void set(size_type index, bool value = true)
+    {
+        (*this)[index] = value;
+    }
+
+    void reset(size_type index)
+    {
+        words_[word_index(index)] &= ~bit_mask(index);
+    }
+
+    void flip(size_type index)
+    {
+        words_[word_index(index)] ^= bit_mask(index);
+    }
+
+    void set()
+    {
+        std::fill(words_.begin(), words_.end(), ~word_type(0));
+        clear_tail();
+    }
+
+    void reset()
+    {
+        std::fill(words_.begin(), words_.end(), word_type(0));
+    }
+
+    void flip()
+    {
+        for (word_type& word : words_)
+        {
+            word = ~word;
+        }
+        clear_tail();
+    }
+
+    void clear()
+    {
+        words_.clear();
+        size_ = 0;
+    }
+
+    void push_back(bool value)
+    {
+        if (size_ % bits_per_word == 0)
+        {
+            words_.push_back(word_type(0));
+        }
+
+        if (value)
+        {
+            words_[word_index(size_)] |= bit_mask(size_);
+        }
+        ++size_;
+    }
+
+    void pop_back()
+    {
+        if (size_ == 0)
+        {
+            return;
+        }
+
+        --size_;
+        reset(size_);
+
+        if (size_ % bits_per_word == 0)
+        {
+            words_.pop_back();
+        }
+    }
+
+    void resize(size_type count, bool value = false)
+    {
+        const size_type old_size = size_;
+        words_.resize(words_for(count), value ? ~word_type(0) : word_type(0));
+        size_ = count;
+
+        if (count > old_size && old_size % bits_per_word != 0)
+        {
+            // the partially used word was kept and has zeroes past old_size
+            const word_type fill = ~word_type(0) << (old_size % bits_per_word);
+            word_type& word = words_[word_index(old_size)];
+            word = value ? (word | fill) : (word & ~fill);
+        }
+        clear_tail();
+    }
+
+    void swap(bit_vector& other)
+    {
+        words_.swap(other.words_);
+        std::swap(size_, other.size_);
+    }
+
+    // BIT QUERIES
+    size_type count() const
+    {
+        return popcount_words(words_.data(), words_.size());
+    }
+
+    bool any() const
+    {
+        return find_first() != npos;
+    }
+
+    bool none() const
+    {
+        return !any();
+    }
+
+    bool all() const
+    {
+        return count() == size_;
+    }
+
+    // Position of the first set bit, or npos.
+    size_type find_first() const
+    {
+        return scan_from_word(0);
+    }
+
+    // Position of the first set bit strictly after pos, or npos.
+    size_type find_next(size_type pos) const
+    {
+        const size_type next = pos + 1;
+
+        if (pos == npos || next >= size_)
+        {
+            return npos;
+        }
+
+        const size_type index = word_index(next);
+        const word_type word = words_[index] & (~word_type(0) << (next % bits_per_word));
+
+        if (word != 0)
+        {
+            return index * bits_per_word + std::countr_zero(word);
+        }
+        return scan_from_word(index + 1);
+    }
+
+    // Number of set bits in [0, pos). Linear in pos; use ctm::rank_select for
+    // repeated queries over an unchanging vector.
+    size_type rank(size_type pos) const
+    {
+        const size_type full_words = word_index(pos);
+        size_type result = popcount_words(words_.data(), full_words);
+
+        if (pos % bits_per_word != 0)
+        {
+            result += std::popcount(words_[full_words] & (bit_mask(pos) - 1));
+        }
+        return result;
+    }
+
+    // Position of the k-th set bit (0-based), or npos.
+    size_type select(size_type k) const
+    {
+        for (size_type i = 0; i < words_.size(); ++i)
+        {
+            const size_type ones = std::popcount(words_[i]);
+
+            if (k < ones)
+            {
+                return i * bits_per_word + select_in_word(words_[i], k);
+            }
+            k -= ones;
+        }
+        return npos;
+    }
+
+    // WORD-PARALLEL OPERATIONS
+    bit_vector& operator&=(const bit_vector& other)
+    {
+        apply_words<word_op::and_>(other);
+        return *this;
+    }
+
+    bit_vector& operator|=(const bit_vector& other)
+    {
+        apply_words<word_op::or_>(other);
+        return *this;
+    }
+
+    bit_vector& operator^=(const bit_vector& other)
+    {
+        apply_words<word_op::xor_>(other);
+        return *this;
+    }
+
+    // this &= ~other
+    bit_vector& and_not(const bit_vector& other)
+    {
+        apply_words<word_op::and_not>(other);
+        return *this;
+    }
+
+    friend bit_vector operator&(bit_vector lhs, const bit_vector& rhs)
+    {
+        return lhs &= rhs;
+    }
+
+    friend bit_vector operator|(bit_vector lhs, const bit_vector& rhs)
+    {
+        return lhs |= rhs;
+    }
+
+    friend bit_vector operator^(bit_vector lhs, const bit_vector& rhs)
+    {
+        return lhs ^= rhs;
+    }
+
+    friend bool operator==(const bit_vector& lhs, const bit_vector& rhs)
+    {
+        return lhs.size_ == rhs.size_ &&
+               std::equal(lhs.words_.begin(), lhs.words_.end(), rhs.words_.begin());
+    }
+
+    // position of the k-th set bit inside a single word, k < popcount(word)
+    static size_type select_in_word(word_type word, size_type k)
+    {
+#if defined(__BMI2__)
+        return std::countr_zero(_pdep_u64(word_type(1) << k, word));
+#else
+        for (size_type i = 0; i < k; ++i)
+        {
+            word &= word - 1;
+        }
+        return std::countr_zero(word);
+#endif
+    }
+
+    static size_type popcount_words(const word_type* words, size_type n)
+    {
+        size_type i = 0;
+        size_type result = 0;
+
+#if defined(__AVX2__)
+        // Mula's nibble lookup: popcount of each byte via pshufb, summed into
+        // 64-bit lanes with psadbw.
+        const __m256i lookup = _mm256_setr_epi8(
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low_mask = _mm256_set1_epi8(0x0f);
+        __m256i acc = _mm256_setzero_si256();
+
+        for (; i + 4 <= n; i += 4)
+        {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+            const __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low_mask));
+            const __m256i hi = _mm256_shuffle_epi8(lookup,
+                _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask));
+            acc = _mm256_add_epi64(acc,
+                _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+        }
+
+        result += static_cast<size_type>(_mm256_extract_epi64(acc, 0)) +
+                  static_cast<size_type>(_mm256_extract_epi64(acc, 1)) +
+                  static_cast<size_type>(_mm256_extract_epi64(acc, 2)) +
+                  static_cast<size_type>(_mm256_extract_epi64(acc, 3));
+#endif
+
+        for (; i < n; ++i)
+        {
+            result += std::popcount(words[i]);
+        }
+        return result;
+    }
+
+private:
+    ctm::vector<word_type> words_;
+    size_type size_;
+
+    static size_type word_index(size_type index)
+    {
+        return index / bits_per_word;
+    }
+
+    static word_type bit_mask(size_type index)
+    {
+        return word_type(1) << (index % bits_per_word);
+    }
+
+    static size_type words_for(size_type bits)
+    {
+        return (bits + bits_per_word - 1) / bits_per_word;
+    }
+
+    void clear_tail()
+    {
+        if (size_ % bits_per_word != 0)
+        {
+            words_.back() &= bit_mask(size_) - 1;
+        }
+    }
+
+    size_type scan_from_word(size_type index) const
+    {
+        for (; index < words_.size(); ++index)
+        {
+            if (words_[index] != 0)
+            {
+                return index * bits_per_word + std::countr_zero(words_[index]);
+            }
+        }
+        return npos;
+    }
+
+    void check_same_size(const bit_vector& other) const
+    {
+        if (size_ != other.size_)
+        {
+            throw std::invalid_argument("bit_vector sizes differ");
+        }
+    }
+
+    enum class word_op
+    {
+        and_,
+        or_,
+        xor_,
+        and_not
+    };
+
+    template <word_op Op>
+    static word_type combine(word_type a, word_type b)
+    {
+        if constexpr (Op == word_op::and_)
+        {
+            return a & b;
+        }
+        else if constexpr (Op == word_op::or_)
+        {
+            return a | b;
+        }
+        else if constexpr (Op == word_op::xor_)
+        {
+            return a ^ b;
+        }
+        else
+        {
+            return a & ~b;
+        }
+    }
+
+    template <word_op Op>
+    void apply_words(const bit_vector& other)
+    {
+        check_same_size(other);
+        word_type* dst = words_.data();
+        const word_type* src = other.words_.data();
+        const size_type n = words_.size();
+        size_type i = 0;
+
+#if defined(__AVX2__)
+        for (; i + 4 <= n; i += 4)
+        {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            __m256i r;
+
+            if constexpr (Op == word_op::and_)
+            {
+                r = _mm256_and_si256(a, b);
+            }
+            else if constexpr (Op == word_op::or_)
+            {
+                r = _mm256_or_si256(a, b);
+            }
+            else if constexpr (Op == word_op::xor_)
+            {
+                r = _mm256_xor_si256(a, b);
+            }
+            else
+            {
+                r = _mm256_andnot_si256(b, a);
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), r);
+        }
+#endif
+
+        for (; i < n; ++i)
+        {
+            dst[i] = combine<Op>(dst[i], src[i]);
+        }
+    }
+};
+
+// Constant-time rank and logarithmic select over a bit_vector that is no
+// longer modified. Stores one cumulative count per 512-bit block (1/8 of the
+// bit_vector's own footprint).
+class rank_select
+{
+public:
+    using size_type = bit_vector::size_type;
+
+    static constexpr size_type words_per_block = 8;
+
+    explicit rank_select(const bit_vector& bits):
+        bits_(&bits),
+        block_ranks_()
+    {
+        const size_type n = bits.num_words();
+        block_ranks_.reserve(n / words_per_block + 2);
+        size_type total = 0;
+
+        for (size_type i = 0; i < n; i += words_per_block)
+        {
+            block_ranks_.push_back(total);
+            total += bit_vector::popcount_words(bits.data() + i,
+                std::min(words_per_block, n - i));
+        }
+        block_ranks_.push_back(total);
+    }
+
+    // Number of set bits in [0, pos).
+    size_type rank(size_type pos) const
+    {
+        const size_type word = pos / bit_vector::bits_per_word;
+        const size_type block = word / words_per_block;
+        size_type result = block_ranks_[block];
+
+        result += bit_vector::popcount_words(bits_->data() + block * words_per_block,
+            word - block * words_per_block);
+
+        if (pos % bit_vector::bits_per_word != 0)
+        {
+            const bit_vector::word_type mask =
+                (bit_vector::word_type(1) << (pos % bit_vector::bits_per_word)) - 1;
+            result += std::popcount(bits_->data()[word] & mask);
+        }
+        return result;
+    }
+
+    // Position of the k-th set bit (0-based), or npos.
+    size_type select(size_type k) const
+    {
+        if (k >= block_ranks_.back())
+        {
+            return bit_vector::npos;
+        }
+
+        // last block whose cumulative rank is <= k
+        const auto it = std::upper_bound(block_ranks_.begin(), block_ranks_.end(), k);
+        const size_type block = static_cast<size_type>(it - block_ranks_.begin()) - 1;
+        k -= block_ranks_[block];
+
+        for (size_type i = block * words_per_block; ; ++i)
+        {
+            const bit_vector::word_type word = bits_->data()[i];
+            const size_type ones = std::popcount(word);
+
+            if (k < ones)
+            {
+                return i * bit_vector::bits_per_word + bit_vector::select_in_word(word, k);
+            }
+            k -= ones;
+        }
+    }
+
+private:
+    const bit_vector* bits_;
+    ctm::vector<size_type> block_ranks_;
+};
+
+};
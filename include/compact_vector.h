@@ -0,0 +1,521 @@
+#pragma once
+
+#include "custom_allocator.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+namespace ctm
+{
+
+// Vector whose only member is a pointer to one heap block that holds a
+// 32-bit size and capacity followed by the elements. An empty
+// compact_vector is a null pointer, so sizeof(compact_vector<T>) is
+// sizeof(void*), which suits many small nested containers such as
+// adjacency lists. Sizes are limited to 2^32 - 1 elements.
+template <typename T, typename Allocator = ctm::allocator<T>>
+class compact_vector
+{
+public:
+    using value_type = T;
+    using size_type = std::uint32_t;
+    using allocator_type = Allocator;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    compact_vector():
+        block_(nullptr) {}
+
+    explicit compact_vector(const Allocator& alloc):
+        block_(nullptr),
+        allocator_(alloc) {}
+
+    explicit compact_vector(std::size_t count, const T& value = T(),
+                            const Allocator& alloc = Allocator()):
+        compact_vector(alloc)
+    {
+        reserve(count);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            push_back(value);
+        }
+    }
+
+    template <typename InputIt,
+              typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+    compact_vector(InputIt first, InputIt last, const Allocator& alloc = Allocator()):
+        compact_vector(alloc)
+    {
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+                          typename std::iterator_traits<InputIt>::iterator_category>)
+        {
+            reserve(static_cast<std::size_t>(std::distance(first, last)));
+        }
+
+        for (; first != last; ++first)
+        {
+            push_back(*first);
+        }
+    }
+
+    compact_vector(std::initializer_list<T> init, const Allocator& alloc = Allocator()):
+        compact_vector(init.begin(), init.end(), alloc) {}
+
+    compact_vector(const compact_vector& other):
+        compact_vector(other.begin(), other.end(),
+                       alloc_traits::select_on_container_copy_construction(other.allocator_)) {}
+
+    compact_vector(compact_vector&& other) noexcept:
+        block_(other.block_),
+        allocator_(other.allocator_)
+    {
+        other.block_ = nullptr;
+    }
+
+    // The allocator is replaced only when its propagate_on_container_*
+    // trait says so. A block is always freed by the allocator that made it.
+    compact_vector& operator=(const compact_vector& other)
+    {
+        if (this != &other)
+        {
+            compact_vector copy(other.begin(), other.end(),
+                                alloc_traits::propagate_on_container_copy_assignment::value
+                                    ? other.allocator_ : allocator_);
+            take<alloc_traits::propagate_on_container_copy_assignment::value>(copy);
+        }
+        return *this;
+    }
+
+    compact_vector& operator=(compact_vector&& other)
+        noexcept(alloc_traits::propagate_on_container_move_assignment::value ||
+                 alloc_traits::is_always_equal::value)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+
+        if constexpr (!alloc_traits::propagate_on_container_move_assignment::value &&
+                      !alloc_traits::is_always_equal::value)
+        {
+            // the block cannot change owners, so the elements move instead
+            if (allocator_ != other.allocator_)
+            {
+                compact_vector moved(std::make_move_iterator(other.begin()),
+                                     std::make_move_iterator(other.end()), allocator_);
+                take<false>(moved);
+                return *this;
+            }
+        }
+
+        take<alloc_traits::propagate_on_container_move_assignment::value>(other);
+        return *this;
+    }
+
+    compact_vector& operator=(std::initializer_list<T> init)
+    {
+        compact_vector copy(init, allocator_);
+        take<false>(copy);
+        return *this;
+    }
+
+    ~compact_vector()
+    {
+        release_memory();
+    }
+
+    // ELEMENT ACCESS
+    reference at(std::size_t index)
+    {
+        if (index >= size())
+        {
+            throw std::out_of_range("Indexing out of range");
+        }
+        return data()[index];
+    }
+
+    const_reference at(std::size_t index) const
+    {
+        if (index >= size())
+        {
+            throw std::out_of_range("Indexing out of range");
+        }
+        return data()[index];
+    }
+
+    reference operator[](std::size_t index)
+    {
+        return data()[index];
+    }
+
+    const_reference operator[](std::size_t index) const
+    {
+        return data()[index];
+    }
+
+    reference front()
+    {
+        return data()[0];
+    }
+
+    const_reference front() const
+    {
+        return data()[0];
+    }
+
+    reference back()
+    {
+        return data()[size() - 1];
+    }
+
+    const_reference back() const
+    {
+        return data()[size() - 1];
+    }
+
+    T* data()
+    {
+        return block_ ? elements(block_) : nullptr;
+    }
+
+    const T* data() const
+    {
+        return block_ ? elements(block_) : nullptr;
+    }
+
+    // ITERATORS
+    iterator begin()
+    {
+        return data();
+    }
+
+    const_iterator begin() const
+    {
+        return data();
+    }
+
+    const_iterator cbegin() const
+    {
+        return data();
+    }
+
+    iterator end()
+    {
+        return data() + size();
+    }
+
+    const_iterator end() const
+    {
+        return data() + size();
+    }
+
+    const_iterator cend() const
+    {
+        return data() + size();
+    }
+
+    // CAPACITY
+    bool empty() const
+    {
+        return (size() == 0);
+    }
+
+    size_type size() const
+    {
+        return block_ ? block_->size : 0;
+    }
+
+    size_type capacity() const
+    {
+        return block_ ? block_->capacity : 0;
+    }
+
+    static constexpr std::size_t max_size()
+    {
+        return std::numeric_limits<size_type>::max();
+    }
+
+    void reserve(std::size_t new_capacity)
+    {
+        if (new_capacity > capacity())
+        {
+            reallocate(new_capacity);
+        }
+    }
+
+    void shrink_to_fit()
+    {
+        if (empty())
+        {
+            release_memory();
+        }
+        else if (size() < capacity())
+        {
+            reallocate(size());
+        }
+    }
+
+    // Destroys every element and frees the block, leaving an empty vector
+    // that owns no memory.
+    void release_memory()
+    {
+        if (block_ == nullptr)
+        {
+            return;
+        }
+
+        clear();
+        deallocate_block(block_);
+        block_ = nullptr;
+    }
+
+    // MODIFIERS
+    void clear()
+    {
+        if (block_ == nullptr)
+        {
+            return;
+        }
+
+        destroy_range(begin(), end());
+        block_->size = 0;
+    }
+
+    void push_back(const T& value)
+    {
+        emplace_back(value);
+    }
+
+    void push_back(T&& value)
+    {
+        emplace_back(std::move(value));
+    }
+
+    template <typename... Args>
+    reference emplace_back(Args&&... args)
+    {
+        if (size() == capacity())
+        {
+            // the argument may alias an element, so build it before growing
+            T value(std::forward<Args>(args)...);
+            grow(static_cast<std::size_t>(size()) + 1);
+            alloc_traits::construct(allocator_, end(), std::move(value));
+        }
+        else
+        {
+            alloc_traits::construct(allocator_, end(), std::forward<Args>(args)...);
+        }
+
+        ++block_->size;
+        return back();
+    }
+
+    void pop_back()
+    {
+        if (empty())
+        {
+            return;
+        }
+
+        alloc_traits::destroy(allocator_, end() - 1);
+        --block_->size;
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        const std::size_t index = static_cast<std::size_t>(pos - begin());
+
+        if (index >= size())
+        {
+            throw std::out_of_range("Erasing index is out of range.");
+        }
+
+        std::move(begin() + index + 1, end(), begin() + index);
+        pop_back();
+        return begin() + index;
+    }
+
+    void resize(std::size_t count, const T& value = T())
+    {
+        if (count < size())
+        {
+            destroy_range(begin() + count, end());
+            block_->size = static_cast<size_type>(count);
+            return;
+        }
+
+        reserve(count);
+
+        while (size() < count)
+        {
+            push_back(value);
+        }
+    }
+
+    // Allocators are exchanged only when propagate_on_container_swap is
+    // true; otherwise they must compare equal, as for standard containers.
+    void swap(compact_vector& other) noexcept
+    {
+        if constexpr (alloc_traits::propagate_on_container_swap::value)
+        {
+            std::swap(allocator_, other.allocator_);
+        }
+        std::swap(block_, other.block_);
+    }
+
+    friend bool operator==(const compact_vector& a, const compact_vector& b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end());
+    }
+
+private:
+    struct header
+    {
+        size_type size;
+        size_type capacity;
+    };
+
+    // Blocks are allocated in units aligned for both the header and T, so
+    // the elements start at the first unit boundary after the header.
+    static constexpr std::size_t alignment = std::max(alignof(header), alignof(T));
+    static constexpr std::size_t elements_offset =
+        (sizeof(header) + alignment - 1) / alignment * alignment;
+
+    struct alignas(alignment) unit
+    {
+        std::byte bytes[alignment];
+    };
+
+    using alloc_traits = std::allocator_traits<Allocator>;
+    using unit_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<unit>;
+    using unit_traits = std::allocator_traits<unit_allocator>;
+
+    header* block_;
+    [[no_unique_address]] Allocator allocator_;
+
+    static T* elements(header* block)
+    {
+        return reinterpret_cast<T*>(reinterpret_cast<std::byte*>(block) + elements_offset);
+    }
+
+    static const T* elements(const header* block)
+    {
+        return reinterpret_cast<const T*>(reinterpret_cast<const std::byte*>(block) + elements_offset);
+    }
+
+    static std::size_t units_for(std::size_t capacity)
+    {
+        return (elements_offset + capacity * sizeof(T) + alignment - 1) / alignment;
+    }
+
+    // Frees the current block and takes other's block, leaving other empty.
+    // Without Propagate the allocators must already compare equal.
+    template <bool Propagate>
+    void take(compact_vector& other)
+    {
+        release_memory();
+
+        if constexpr (Propagate)
+        {
+            allocator_ = other.allocator_;
+        }
+
+        block_ = other.block_;
+        other.block_ = nullptr;
+    }
+
+    void destroy_range(T* first, T* last)
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            for (; first != last; ++first)
+            {
+                alloc_traits::destroy(allocator_, first);
+            }
+        }
+    }
+
+    void deallocate_block(header* block)
+    {
+        unit_allocator alloc(allocator_);
+        unit_traits::deallocate(alloc, reinterpret_cast<unit*>(block), units_for(block->capacity));
+    }
+
+    void grow(std::size_t required)
+    {
+        if (required > max_size())
+        {
+            throw std::length_error("compact_vector size exceeds 32 bits");
+        }
+
+        std::size_t new_capacity = capacity() == 0 ? 1 : 2 * static_cast<std::size_t>(capacity());
+
+        while (new_capacity < required)
+        {
+            new_capacity *= 2;
+        }
+
+        reallocate(std::min(new_capacity, max_size()));
+    }
+
+    void reallocate(std::size_t new_capacity)
+    {
+        if (new_capacity > max_size())
+        {
+            throw std::length_error("compact_vector size exceeds 32 bits");
+        }
+
+        unit_allocator alloc(allocator_);
+        const std::size_t units = units_for(new_capacity);
+        unit* storage = unit_traits::allocate(alloc, units);
+        const size_type count = size();
+        header* block = ::new (static_cast<void*>(storage)) header{count, static_cast<size_type>(new_capacity)};
+
+        if (block_)
+        {
+            if constexpr (std::is_trivially_copyable_v<T>)
+            {
+                std::memcpy(static_cast<void*>(elements(block)), elements(block_), count * sizeof(T));
+            }
+            else
+            {
+                // a throwing move leaves this vector as it was
+                T* dst = elements(block);
+                size_type built = 0;
+
+                try
+                {
+                    for (; built < count; ++built)
+                    {
+                        alloc_traits::construct(allocator_, dst + built, std::move(begin()[built]));
+                    }
+                }
+                catch (...)
+                {
+                    destroy_range(dst, dst + built);
+                    unit_traits::deallocate(alloc, storage, units);
+                    throw;
+                }
+
+                destroy_range(begin(), end());
+            }
+
+            deallocate_block(block_);
+        }
+
+        block_ = block;
+    }
+};
+
+};
@@ -4,6 +4,11 @@
 #include <memory>
 #include <iostream>
 #include <limits>
+#include <type_traits>
+
+#if defined(CTM_ALLOCATOR_STATS)
+#include "allocation_stats.h"
+#endif
 
 namespace ctm
 {
@@ -18,12 +23,15 @@ public:
 
     constexpr allocator() noexcept = default;
 
-    allocator( const allocator& other ) noexcept = default;
+    constexpr allocator( const allocator& other ) noexcept = default;
 
     template <typename U>
     constexpr allocator( const allocator<U>& other) noexcept {};
 
-    T* allocate(const std::size_t n)
+    // In constant evaluation the storage comes from std::allocator, the only
+    // allocation the language allows there; it must be freed before the
+    // evaluation ends.
+    constexpr T* allocate(const std::size_t n)
     {
         if (n == 0)
         {
@@ -35,27 +43,44 @@ public:
             throw std::bad_alloc();
         }
 
+        if (std::is_constant_evaluated())
+        {
+            return std::allocator<T>().allocate(n);
+        }
+
         T* ptr = static_cast<T*>(::operator new(n * sizeof(T)));
+#if defined(CTM_ALLOCATOR_STATS)
+        ctm::detail::record_allocation(n * sizeof(T));
+#endif
         return ptr;
     }
 
-    void deallocate(T* p, const std::size_t n) noexcept
+    constexpr void deallocate(T* p, const std::size_t n) noexcept
     {
+        if (std::is_constant_evaluated())
+        {
+            std::allocator<T>().deallocate(p, n);
+            return;
+        }
+
         if (p)
         {
+#if defined(CTM_ALLOCATOR_STATS)
+            ctm::detail::record_deallocation(n * sizeof(T));
+#endif
             ::operator delete(p);
         }
         return;
     }
 
     template <typename U, typename... Args>
-    void construct(U* p, Args&&... args)
+    constexpr void construct(U* p, Args&&... args)
     {
-        ::new ((void*)p) U(std::forward<Args>(args)...);
+        std::construct_at(p, std::forward<Args>(args)...);
     }
 
     template <typename U>
-    void destroy(U* p) noexcept
+    constexpr void destroy(U* p) noexcept
     {
         if (p) 
         {
@@ -69,7 +94,7 @@ public:
         using other = allocator<U>;
     };
 
-    std::size_t max_size() const noexcept
+    constexpr std::size_t max_size() const noexcept
     {
         return std::numeric_limits<size_type>::max() / sizeof(T);
     }
@@ -1,12 +1,51 @@
 #pragma once
 
 #include "custom_allocator.h"
+#include "streaming_store.h"
+#include "prefault.h"
 #include <memory>
+#include <memory_resource>
 #include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iterator>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__AVX2__) && defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#if defined(CTM_VECTOR_TRACING)
+#include "realloc_trace.h"
+#endif
+
+// Marks rarely taken slow paths, such as growth, so that they stay out of
+// line and out of the caller's hot loop.
+#if defined(__GNUC__)
+#define CTM_COLD_PATH __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#define CTM_COLD_PATH __declspec(noinline)
+#else
+#define CTM_COLD_PATH
+#endif
 
 namespace ctm 
 {
 
+// Tag selecting the range constructor, as std::from_range does in C++23.
+struct from_range_t
+{
+    explicit from_range_t() = default;
+};
+
+inline constexpr from_range_t from_range{};
+
+template <typename R, typename T>
+concept container_compatible_range =
+    std::ranges::input_range<R> && std::convertible_to<std::ranges::range_reference_t<R>, T>;
+
 template <typename T, typename Allocator = ctm::allocator<T>>
 class vector 
 {
@@ -20,19 +59,19 @@ public:
     using iterator = T*;
     using const_iterator = const T*;
 
-    vector():
+    constexpr vector():
         vector(Allocator()) {}
 
-    explicit vector(const Allocator& alloc):
+    constexpr explicit vector(const Allocator& alloc):
         data_(nullptr),
         size_(0),
         capacity_(0),
         allocator_(alloc) {}
 
-    explicit vector(size_type count, const Allocator& alloc = Allocator()):
-        vector(count, T(), Allocator()) {}
+    constexpr explicit vector(size_type count, const Allocator& alloc = Allocator()):
+        vector(count, T(), alloc) {}
 
-    vector(size_type count, const T& value,
+    constexpr vector(size_type count, const T& value,
            const Allocator& alloc = Allocator()):
         data_(nullptr),
         size_(0),
@@ -45,31 +84,28 @@ public:
 
     template <typename InputIt,
               typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
-    explicit vector(InputIt first, InputIt last,
+    constexpr explicit vector(InputIt first, InputIt last,
            const Allocator& alloc = Allocator()):
         data_(nullptr),
         size_(0),
         capacity_(0),
         allocator_(alloc)
     {
-        while (first != last)
-        {
-            push_back(*first);
-            ++first;
-        }
+        insert(end(), first, last);
     }
 
-    vector(const vector& other):
-        vector(other.begin(), other.end()) {}
+    constexpr vector(const vector& other):
+        vector(other.begin(), other.end(),
+               alloc_traits::select_on_container_copy_construction(other.allocator_)) {}
 
-    vector(vector&& other):
-        vector(std::move(other), Allocator()) {}
+    constexpr vector(vector&& other):
+        vector(std::move(other), other.allocator_) {}
 
-    vector(const vector& other,
+    constexpr vector(const vector& other,
            const Allocator& alloc):
         vector(other.begin(), other.end(), alloc) {}
     
-    vector(vector&& other,
+    constexpr vector(vector&& other,
            const Allocator& alloc):
         data_(nullptr),
         size_(0),
@@ -87,71 +123,99 @@ public:
 
         while (it_begin != it_end)
         {
-            push_back(std::move(*it_begin));
+            push_back(*it_begin);
             ++it_begin;
         }
     }
 
-    vector(std::initializer_list<value_type> init,
+    template <ctm::container_compatible_range<T> R>
+    constexpr vector(ctm::from_range_t, R&& range, const Allocator& alloc = Allocator()):
+        data_(nullptr),
+        size_(0),
+        capacity_(0),
+        allocator_(alloc)
+    {
+        append_range(std::forward<R>(range));
+    }
+
+    constexpr vector(std::initializer_list<value_type> init,
            const Allocator& alloc = Allocator()):
-        vector(init.begin(), init.end()) {}
+        vector(init.begin(), init.end(), alloc) {}
 
-    vector& operator=(const vector& other)
+    // Allocators are replaced on assignment and swap only when their
+    // propagate_on_container_* trait says so; std::pmr allocators never
+    // propagate, so a vector keeps its memory resource for life.
+    constexpr vector& operator=(const vector& other)
     {
+        if constexpr (alloc_traits::propagate_on_container_copy_assignment::value)
+        {
+            if (allocator_ != other.allocator_)
+            {
+                release_memory();
+            }
+            allocator_ = other.allocator_;
+        }
+
         clear();
-        reserve(next_capacity_power_of_two(other.size()));
+        reserve(other.capacity());
         insert(begin(), other.begin(), other.end());
-        capacity_ = other.capacity();
 
         return *this;
     }
 
-    vector& operator=(vector&& other)
+    constexpr vector& operator=(vector&& other)
     {
+        if constexpr (alloc_traits::propagate_on_container_move_assignment::value)
+        {
+            if (allocator_ != other.allocator_)
+            {
+                release_memory();
+            }
+            allocator_ = other.allocator_;
+        }
+
         clear();
+        reserve(other.capacity());
         iterator it_begin = other.begin();
         iterator it_end = other.end();
 
         while (it_begin != it_end)
         {
-            push_back(std::move(*it_begin));
+            push_back(*it_begin);
             ++it_begin;
         }
-        
-        capacity_ = other.capacity();
 
         return *this;
     }
 
-    vector& operator=(std::initializer_list<value_type> init)
+    constexpr vector& operator=(std::initializer_list<value_type> init)
     {
         clear();
         reserve(next_capacity_power_of_two(init.size()));
         insert(begin(), init.begin(), init.end());
+
+        return *this;
     }
 
-    ~vector()
+    constexpr ~vector()
     {
         if (data_ == nullptr)
         {
             return;
         }
 
-        for (size_t i = 0; i < size_; ++i)
-        {
-            allocator_.destroy(data_ + i);
-        }
+        destroy_range(begin(), end());
 
         if (data_)
         {
-            allocator_.deallocate(data_, capacity_);
+            alloc_traits::deallocate(allocator_, data_, capacity_);
         }
 
         data_ = nullptr;
     }
     
     // ELEMENT ACCESS
-    reference at(std::size_t index)
+    constexpr reference at(std::size_t index)
     {
         if (index < 0 || index >= size_)
         {
@@ -160,7 +224,7 @@ public:
         return data_[index];
     }
     
-    const_reference at(std::size_t index) const
+    constexpr const_reference at(std::size_t index) const
     {
         if (index < 0 || index >= size_)
         {
@@ -169,378 +233,498 @@ public:
         return data_[index];
     }
 
-    reference operator[](std::size_t index)
+    constexpr reference operator[](std::size_t index)
     {
         return data_[index];
     }
 
     // accessed when using const vector
-    const_reference operator[](std::size_t index) const
+    constexpr const_reference operator[](std::size_t index) const
     {
         return data_[index];
     }
 
-    reference front() 
+    constexpr reference front() 
     {
         return data_[0];
     }
 
-    const_reference front() const 
+    constexpr const_reference front() const 
     {
         return data_[0];
     }
 
-    reference back()
+    constexpr reference back()
     {
         return data_[size_ - 1];
     }
 
-    const_reference back() const
+    constexpr const_reference back() const
     {
         return data_[size_ - 1];
     }
 
-    T* data() 
+    constexpr T* data() 
     {
         return data_;
     }
 
-    const T* data() const
+    constexpr const T* data() const
     {
         return data_;
     }
 
     // Iterators
-    iterator begin()
+    constexpr iterator begin()
     {
         return data_;
     }
 
-    const_iterator begin() const
+    constexpr const_iterator begin() const
     {
         return data_;
     }
 
-    const_iterator cbegin() const
+    constexpr const_iterator cbegin() const
     {
         return data_;
     }
 
-    iterator end()
+    constexpr iterator end()
     {
         return data_ + size_;
     }
 
-    const_iterator end() const
+    constexpr const_iterator end() const
     {
         return data_ + size_;
     }
 
-    const_iterator cend() const
+    constexpr const_iterator cend() const
     {
         return data_ + size_;
     }
 
     // CAPACITY
-    bool empty() const
+    constexpr bool empty() const
     {
         return (size_ == 0);
     }
 
-    size_type size() const
+    constexpr size_type size() const
     {
         return size_;
     }
 
-    size_type max_size() const
+    constexpr size_type max_size() const
     {
         return std::numeric_limits<size_type>::max()/sizeof(T);
     }
 
-    void reserve(std::size_t new_capacity)
+    constexpr void reserve(std::size_t new_capacity)
     {
         if (new_capacity <= capacity_)
         {
             return;
         }
 
-        T* new_data = allocator_.allocate(new_capacity);
+        reallocate(new_capacity, size_, 0);
+    }
 
-        for (std::size_t i = 0; i < size_; ++i)
-        {
-            allocator_.construct(new_data + i, std::move(data_[i]));
-            allocator_.destroy(data_ + i);
-        }
+    // Reserves, then faults in every page of the unused capacity so that the
+    // first writes to it take no page faults.
+    constexpr void reserve(size_type new_capacity, ctm::prefault_t)
+    {
+        reserve(new_capacity);
 
-        if (data_)
+        if (!std::is_constant_evaluated())
         {
-            allocator_.deallocate(data_, capacity_);
+            detail::prefault_pages(data_ + size_, (capacity_ - size_) * sizeof(T));
         }
-
-        data_ = new_data;
-        capacity_ = new_capacity;
     }
 
-    size_type capacity() const
+    // Reserves and populates the pages on a background thread, so warm-up
+    // can overlap other work. Destroying the future waits for it; a later
+    // reallocation only makes the warm-up useless, never unsafe.
+    std::future<void> reserve(size_type new_capacity, ctm::prefault_async_t)
     {
-        return capacity_;
+        reserve(new_capacity);
+        return detail::prefault_pages_async(data_ + size_, (capacity_ - size_) * sizeof(T));
     }
 
-    // MODIFIERS
-    void clear() 
+    constexpr size_type capacity() const
     {
-        for (std::size_t i = 0; i < size_; ++i) 
-        {
-            allocator_.destroy(data_ + i);
-        }
-
-        size_ = 0;
-        // capacity is not released as per the standard's implementation
+        return capacity_;
     }
 
-    iterator insert(const_iterator pos, const T& value)
+    // Reallocates to exactly size() elements, or frees the buffer when empty.
+    constexpr void shrink_to_fit()
     {
-        return insert(pos, 1, value);
+        shrink_to(size_);
     }
 
-    iterator insert(const_iterator pos, T&& value)
+    // Lowers the capacity to max(new_capacity, size()); never grows.
+    constexpr void shrink_to(size_type new_capacity)
     {
-        if (pos == end())
+        new_capacity = std::max(new_capacity, size_);
+
+        if (new_capacity >= capacity_)
         {
-            push_back(std::move(value));
-            return end()-1;
+            return;
         }
 
-        const difference_type index = pos - begin();
-
-        if (!(0 <= index && index < size()))
+        if (new_capacity == 0)
         {
-            throw new std::out_of_range("Inserting index is out of range (more than size.");
+            release_memory();
+            return;
         }
 
-        if (size() + 1 > capacity())
+        reallocate(new_capacity, size_, 0);
+    }
+
+    // Destroys every element and frees the buffer, leaving capacity() == 0.
+    constexpr void release_memory()
+    {
+        clear();
+
+        if (data_)
         {
-            reserve(next_capacity_power_of_two(capacity_+1));
+            alloc_traits::deallocate(allocator_, data_, capacity_);
         }
 
-        iterator it_move_begin = &data_[index];
-        std::move(it_move_begin, end(), it_move_begin + 1);
-        *it_move_begin = std::move(value);
-        ++size_;
-        return it_move_begin;
+        data_ = nullptr;
+        capacity_ = 0;
     }
 
+    // Names this vector in reallocation events. The string must outlive the
+    // vector. Does nothing unless built with CTM_VECTOR_TRACING.
+    constexpr void set_trace_tag(const char* tag)
+    {
+#if defined(CTM_VECTOR_TRACING)
+        trace_tag_ = tag;
+#endif
+    }
 
-    iterator insert(const_iterator pos, size_type count, const T& value)
+    constexpr const char* trace_tag() const
     {
-        if (pos == end())
-        {
-            for (size_type i = 0; i < count; ++i)
-            {
-                push_back(value);
-            }
-            return end()-count;
-        }
+#if defined(CTM_VECTOR_TRACING)
+        return trace_tag_;
+#else
+        return nullptr;
+#endif
+    }
 
-        const difference_type index = pos - begin();
+    // MODIFIERS
+    constexpr void clear() 
+    {
+        destroy_range(begin(), end());
+        size_ = 0;
+        // capacity is not released as per the standard's implementation
+    }
 
-        if (!(0 <= index && index < size()))
-        {
-            throw new std::out_of_range("Inserting index is out of range (more than size.");
-        }
+    constexpr iterator insert(const_iterator pos, const T& value)
+    {
+        return emplace(pos, value);
+    }
 
-        if (size() + count > capacity())
-        {
-            reserve(next_capacity_power_of_two(size() + count));
-        }
+    constexpr iterator insert(const_iterator pos, T&& value)
+    {
+        return emplace(pos, std::move(value));
+    }
 
-        iterator it_move_begin = &data_[index];
-        std::move(it_move_begin, end(), it_move_begin + count);
+    constexpr iterator insert(const_iterator pos, size_type count, const T& value)
+    {
+        const size_type index = checked_index(pos);
 
-        for (size_type i = index; i < index + count; ++i)
+        if (count == 0)
         {
-            data_[i] = value;
+            return data_ + index;
         }
 
-        size_ += count;
-        return it_move_begin;
+        // value may refer to an element of this vector
+        const T copy(value);
+        return fill_gap(index, count, [this, count, &copy](T* gap) { construct_fill(gap, count, copy); });
     }
 
     template <typename InputIt,
               typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
-    iterator insert(const_iterator pos, InputIt first, InputIt last)
+    constexpr iterator insert(const_iterator pos, InputIt first, InputIt last)
     {
-        const difference_type count = static_cast<difference_type>(last-first);
+        const size_type index = checked_index(pos);
 
-        if (pos == end())
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+                          typename std::iterator_traits<InputIt>::iterator_category>)
         {
-            while (first != last)
+            const size_type count = static_cast<size_type>(std::distance(first, last));
+
+            if (count == 0)
             {
-                push_back(*first);
-                ++first;
+                return data_ + index;
             }
 
-            return end()-count;
-        }
-
-        difference_type index = pos - begin();
-        
-        if (!(0 <= index && index < size()))
-        {
-            throw new std::out_of_range("Inserting index is out of range (more than size.");
+            return fill_gap(index, count, [this, count, first](T* gap) { construct_from(gap, first, count); });
         }
-
-        if (size() + count > capacity())
+        else
         {
-            reserve(next_capacity_power_of_two(size() + count));
-        }
-
-        iterator it_move_begin = &data_[index];
-        std::move(it_move_begin, end(), it_move_begin + count);
+            // single-pass input: append, then rotate into place
+            const size_type old_size = size_;
 
-        while (first != last)
-        {
-            data_[index] = *first;
-            ++index;
-            ++first;
-        }           
+            while (first != last)
+            {
+                push_back(*first);
+                ++first;
+            }
 
-        size_ += count;
-        return it_move_begin;
+            std::rotate(begin() + index, begin() + old_size, end());
+            return data_ + index;
+        }
     }
 
-    iterator insert(const_iterator pos, std::initializer_list<T> ilist)
+    constexpr iterator insert(const_iterator pos, std::initializer_list<T> ilist)
     {
         return insert(pos, ilist.begin(), ilist.end());
     }
 
     template <typename... Args>
-    iterator emplace(const_iterator pos, Args&&... args)
+    constexpr iterator emplace(const_iterator pos, Args&&... args)
     {
-        if (pos == end())
-        {
-            push_back(T(std::forward<Args>(args)...));
-            return end()-1;
-        }
+        const size_type index = checked_index(pos);
+        // built before the gap is made, as args may refer to elements that
+        // are about to move
+        T value(std::forward<Args>(args)...);
+        return fill_gap(index, 1, [this, &value](T* gap) { alloc_traits::construct(allocator_, gap, std::move(value)); });
+    }
 
-        const difference_type index = pos - begin();
+    constexpr iterator erase(const_iterator pos)
+    {
+        return erase(pos, pos + 1);
+    }
+    
+    constexpr iterator erase(const_iterator first, const_iterator last)
+    {
+        const size_type index = static_cast<size_type>(first - begin());
+        const size_type count = static_cast<size_type>(last - first);
 
-        if (!(0 <= index && index < size()))
+        if (count == 0)
         {
-            throw new std::out_of_range("Emplace position is out of range (more than size.");
+            return data_ + index;
         }
 
-        if (size() + 1 > capacity())
+        if (last != end())
         {
-            reserve(2 * capacity());
+            if (bitwise_copyable())
+            {
+                std::memmove(static_cast<void*>(data_ + index), data_ + index + count,
+                             (size_ - index - count) * sizeof(T));
+                size_ -= count;
+                return data_ + index;
+            }
+
+            std::move(data_ + index + count, end(), data_ + index);
         }
 
-        iterator it_move_begin = &data_[index];
-        std::move(it_move_begin, end(), it_move_begin + 1);
-        *it_move_begin = T(std::forward<Args>(args)...);
-        ++size_;
-        return it_move_begin;
+        destroy_range(end() - count, end());
+        size_ -= count;
+        return data_ + index;
     }
-
-    iterator erase(const_iterator pos)
+    // Removes the element at pos by moving the last element into its place.
+    // O(1), but the order of the remaining elements is not preserved.
+    // Returns an iterator to the element now at pos, or end().
+    constexpr iterator erase_unordered(const_iterator pos)
     {
-        const difference_type index = pos-begin();
+        iterator it = begin() + (pos - begin());
+        iterator last = end() - 1;
 
-        if (index == size()-1)
+        if (it != last)
         {
-            --size_;
-            allocator_.destroy(&data_[index]);
-            return end();
+            *it = std::move(*last);
         }
 
-        allocator_.destroy(&data_[index]);
-        iterator it_move_begin = &data_[index+1];
-        std::move(it_move_begin, end(), &data_[index]);
-        allocator_.destroy(&data_[size()-1]);
+        alloc_traits::destroy(allocator_, last);
         --size_;
-        return it_move_begin;
+        return it;
     }
-    
-    iterator erase(const_iterator first, const_iterator last)
+
+    // Removes every element for which pred returns true, filling each hole
+    // with a kept element taken from the back. Moves at most one element
+    // per removal and destroys the tail once; the order of the remaining
+    // elements is not preserved. Returns the number of elements removed.
+    template <typename Pred>
+    constexpr size_type erase_unordered_if(Pred pred)
     {
-        const difference_type len_to_first = first-begin();
-        iterator it = begin() + len_to_first;
+        iterator first = begin();
+        iterator last = end();
 
-        if (last == end())
+        while (true)
         {
-            while (it != last)
+            while (first != last && !pred(*first))
+            {
+                ++first;
+            }
+
+            if (first == last)
             {
-                --size_;
-                allocator_.destroy(it);
-                ++it;
+                break;
             }
-            return end();
-        }
 
-        iterator it_end = end();
+            --last;
 
-        while (it != last)
-        {
-            allocator_.destroy(it);
-            ++it;
-            --size_;
+            while (first != last && pred(*last))
+            {
+                --last;
+            }
+
+            if (first == last)
+            {
+                break;
+            }
+
+            *first = std::move(*last);
+            ++first;
         }
 
-        std::move(it, it_end, begin()+len_to_first);
+        const size_type removed = static_cast<size_type>(end() - first);
+        destroy_range(first, end());
+        size_ -= removed;
+        return removed;
+    }
 
-        const difference_type size_to_end = last-begin();
-        iterator it_to_destroy = begin() + size_to_end;
+    // Sized ranges are appended with one reservation and a bulk copy
+    // (memcpy when contiguous and trivially copyable); other ranges grow
+    // geometrically element by element.
+    template <ctm::container_compatible_range<T> R>
+    constexpr void append_range(R&& range)
+    {
+        if constexpr (std::ranges::sized_range<R>)
+        {
+            const size_type count = static_cast<size_type>(std::ranges::size(range));
+
+            if (count == 0)
+            {
+                return;
+            }
 
-        while (it_to_destroy != it_end)
+            if constexpr (std::ranges::contiguous_range<R>)
+            {
+                // growing would free a source that lives in this vector
+                const auto* source = std::ranges::data(range);
+
+                if (!std::is_constant_evaluated() && size_ + count > capacity_ &&
+                    static_cast<const void*>(source) >= static_cast<const void*>(data_) &&
+                    static_cast<const void*>(source) < static_cast<const void*>(data_ + size_))
+                {
+                    vector copy(source, source + count);
+                    append_range(copy);
+                    return;
+                }
+
+                fill_gap(size_, count, [this, count, source](T* gap) { construct_from(gap, source, count); });
+            }
+            else
+            {
+                fill_gap(size_, count, [this, count, &range](T* gap)
+                {
+                    construct_from(gap, std::ranges::begin(range), count);
+                });
+            }
+        }
+        else
         {
-            allocator_.destroy(it_to_destroy);
-            ++it_to_destroy;
+            for (auto&& value : range)
+            {
+                emplace_back(std::forward<decltype(value)>(value));
+            }
         }
+    }
 
-        return it;
+    template <ctm::container_compatible_range<T> R>
+    constexpr void assign_range(R&& range)
+    {
+        clear();
+        append_range(std::forward<R>(range));
     }
 
-    void push_back(const T& value)
+    constexpr void push_back(const T& value)
+    {
+        emplace_back(value);
+    }
+
+    constexpr void push_back(T&& value)
+    {
+        emplace_back(std::move(value));
+    }
+
+    template<typename... Args>
+    constexpr reference emplace_back(Args&&... args)
     {
         if (size_ == capacity_)
         {
-            reserve(next_capacity_power_of_two(capacity_+1));
+            return emplace_back_grow(std::forward<Args>(args)...);
         }
 
-        allocator_.construct(data_ + size_, value);
+        alloc_traits::construct(allocator_, data_ + size_, std::forward<Args>(args)...);
+        return data_[size_++];
+    }
+
+    // Appends without checking capacity. The caller must have reserved room
+    // first, e.g. reserve(size() + n) before n calls.
+    constexpr void push_back_unchecked(const T& value)
+    {
+        alloc_traits::construct(allocator_, data_ + size_, value);
         ++size_;
     }
 
-    void push_back(const T&& value)
+    constexpr void push_back_unchecked(T&& value)
     {
-        if (size_ == capacity_)
+        alloc_traits::construct(allocator_, data_ + size_, std::move(value));
+        ++size_;
+    }
+
+    // Appends count elements, each constructed from gen(), with one capacity
+    // check for the whole batch. If gen throws, the elements already added
+    // are kept.
+    template <typename Generator>
+    constexpr void append_n(size_type count, Generator gen)
+    {
+        T* out = reserve_back(count);
+        T* const last = out + count;
+
+        try
+        {
+            for (; out != last; ++out)
+            {
+                alloc_traits::construct(allocator_, out, gen());
+            }
+        }
+        catch (...)
         {
-            reserve(next_capacity_power_of_two(capacity_ + 1));
+            size_ = static_cast<size_type>(out - data_);
+            throw;
         }
 
-        allocator_.construct(data_ + size_, std::move(value));
-        ++size_;
+        size_ += count;
     }
 
-    template<typename... Args>
-    reference emplace_back(Args&&... args)
+    // Appends count elements, each constructed from args, with one capacity
+    // check. args must not refer to elements of this vector.
+    template <typename... Args>
+    constexpr void emplace_back_n(size_type count, const Args&... args)
     {
-        push_back(std::move(T(std::forward<Args>(args)...)));
-        return data_[size()-1];
+        append_n(count, [&args...]() { return T(args...); });
     }
 
-    void pop_back()
+    constexpr void pop_back()
     {
         if (size() == 0)
         {
             return;
         }
 
-        allocator_.destroy(end()-1);
+        alloc_traits::destroy(allocator_, end()-1);
         --size_;
     }
 
-    void resize(size_type count)
+    constexpr void resize(size_type count)
     {
         if (count == size())
         {
@@ -559,7 +743,7 @@ public:
         }
     }
 
-    void resize(size_type count, const value_type& value)
+    constexpr void resize(size_type count, const value_type& value)
     {
         if (count == size())
         {
@@ -578,35 +762,337 @@ public:
         }
     }
 
-    void swap(ctm::vector<T>& other)
+    // Buffers are exchanged when the allocators propagate or compare equal.
+    // Otherwise each vector keeps its allocator and the elements are moved
+    // across into storage from it.
+    constexpr void swap(vector& other)
     {
-        std::swap(size_, other.size_);
-        std::swap(capacity_, other.capacity_);
-        std::swap(allocator_, other.allocator_);
-        std::swap(data_, other.data_);
+        if constexpr (alloc_traits::propagate_on_container_swap::value)
+        {
+            std::swap(allocator_, other.allocator_);
+        }
+        else if (allocator_ != other.allocator_)
+        {
+            vector to_other(std::move(*this), other.allocator_);
+            vector to_this(std::move(other), allocator_);
+            swap_storage(to_this);
+            other.swap_storage(to_other);
+            return;
+        }
+
+        swap_storage(other);
+    }
+
+    constexpr allocator_type get_allocator() const
+    {
+        return allocator_;
     }
 
 private:
+    using alloc_traits = std::allocator_traits<Allocator>;
+
     T* data_;
     std::size_t size_;  
     std::size_t capacity_;
     Allocator allocator_;
+#if defined(CTM_VECTOR_TRACING)
+    const char* trace_tag_ = nullptr;
+#endif
 
-    size_type next_capacity_power_of_two(size_type new_capacity)
+    constexpr void swap_storage(vector& other)
     {
-        const size_type current_capacity = capacity();
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(data_, other.data_);
+    }
 
-        if (new_capacity  <= current_capacity)
+    // Elements of trivially copyable types are relocated with memcpy and
+    // memmove; constant evaluation always takes the element-wise path.
+    static constexpr bool bitwise_copyable()
+    {
+        return std::is_trivially_copyable_v<T> && !std::is_constant_evaluated();
+    }
+
+    constexpr size_type checked_index(const_iterator pos) const
+    {
+        const difference_type index = pos - begin();
+
+        if (index < 0 || static_cast<size_type>(index) > size_)
         {
-            return current_capacity;
+            throw std::out_of_range("Inserting index is out of range (more than size).");
+        }
+        return static_cast<size_type>(index);
+    }
+
+    // Move-constructs count elements from src into raw storage at dst and
+    // destroys the sources.
+    constexpr void relocate(T* src, size_type count, T* dst)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        if (bitwise_copyable())
+        {
+            std::memcpy(static_cast<void*>(dst), src, count * sizeof(T));
+            return;
+        }
+
+        for (size_type i = 0; i < count; ++i)
+        {
+            alloc_traits::construct(allocator_, dst + i, std::move(src[i]));
+            alloc_traits::destroy(allocator_, src + i);
+        }
+    }
+
+    template <typename ForwardIt>
+    constexpr void construct_from(T* dst, ForwardIt first, size_type count)
+    {
+        if constexpr (std::is_pointer_v<ForwardIt> &&
+                      std::is_same_v<std::remove_cv_t<std::remove_pointer_t<ForwardIt>>, T>)
+        {
+            if (bitwise_copyable())
+            {
+#if defined(__SSE2__)
+                if (detail::use_streaming_stores(count * sizeof(T)))
+                {
+                    detail::stream_copy(dst, first, count * sizeof(T));
+                    return;
+                }
+#endif
+                std::memcpy(static_cast<void*>(dst), first, count * sizeof(T));
+                return;
+            }
+        }
+
+        size_type built = 0;
+
+        try
+        {
+            for (; built < count; ++built, ++first)
+            {
+                alloc_traits::construct(allocator_, dst + built, *first);
+            }
+        }
+        catch (...)
+        {
+            destroy_range(dst, dst + built);
+            throw;
+        }
+    }
+
+    constexpr void construct_fill(T* dst, size_type count, const T& value)
+    {
+#if defined(__SSE2__)
+        if constexpr (16 % sizeof(T) == 0)
+        {
+            if (bitwise_copyable() && detail::use_streaming_stores(count * sizeof(T)))
+            {
+                detail::stream_fill(dst, count, value);
+                return;
+            }
+        }
+#endif
+
+        size_type built = 0;
+
+        try
+        {
+            for (; built < count; ++built)
+            {
+                alloc_traits::construct(allocator_, dst + built, value);
+            }
+        }
+        catch (...)
+        {
+            destroy_range(dst, dst + built);
+            throw;
+        }
+    }
+
+    // Moves every element into a new buffer of new_capacity, leaving gap
+    // raw slots starting at index. size_ is left for the caller to update.
+    constexpr void reallocate(size_type new_capacity, size_type index, size_type gap)
+    {
+#if defined(CTM_VECTOR_TRACING)
+        bool traced = false;
+        std::chrono::steady_clock::time_point trace_start;
+        const std::size_t old_capacity = capacity_;
+
+        if (!std::is_constant_evaluated() && ctm::detail::realloc_tracing_active())
+        {
+            traced = true;
+            trace_start = std::chrono::steady_clock::now();
+        }
+#endif
+
+        T* new_data = alloc_traits::allocate(allocator_, new_capacity);
+        relocate(data_, index, new_data);
+        relocate(data_ + index, size_ - index, new_data + index + gap);
+
+        if (data_)
+        {
+            alloc_traits::deallocate(allocator_, data_, capacity_);
+        }
+
+        data_ = new_data;
+        capacity_ = new_capacity;
+
+#if defined(CTM_VECTOR_TRACING)
+        if (traced)
+        {
+            ctm::detail::report_realloc(ctm::realloc_event{
+                this, trace_tag_, old_capacity, new_capacity, size_, size_ * sizeof(T),
+                trace_start, std::chrono::steady_clock::now() - trace_start});
+        }
+#endif
+    }
+
+    // Opens count raw slots at index, growing in the same pass when the
+    // elements do not fit. Tail elements that land past the old end are
+    // move-constructed, the rest move-assigned; the moved-from objects left
+    // inside the gap are destroyed so that the whole gap is raw storage.
+    constexpr T* make_gap(size_type index, size_type count)
+    {
+        if (size_ + count > capacity_)
+        {
+            reallocate(next_capacity_power_of_two(size_ + count), index, count);
+            return data_ + index;
+        }
+
+        if (index == size_)
+        {
+            return data_ + index;
+        }
+
+        if (bitwise_copyable())
+        {
+            std::memmove(static_cast<void*>(data_ + index + count), data_ + index,
+                         (size_ - index) * sizeof(T));
+            return data_ + index;
+        }
+
+        for (size_type i = size_; i-- > index; )
+        {
+            if (i + count >= size_)
+            {
+                alloc_traits::construct(allocator_, data_ + i + count, std::move(data_[i]));
+            }
+            else
+            {
+                data_[i + count] = std::move(data_[i]);
+            }
+        }
+
+        destroy_range(data_ + index, data_ + std::min(index + count, size_));
+        return data_ + index;
+    }
+
+    // Undoes make_gap(index, count) once the gap is raw storage again: the
+    // tail moves back down and the objects left past the old end are
+    // destroyed.
+    constexpr void close_gap(size_type index, size_type count)
+    {
+        if (index == size_)
+        {
+            return;
+        }
+
+        if (bitwise_copyable())
+        {
+            std::memmove(static_cast<void*>(data_ + index), data_ + index + count,
+                         (size_ - index) * sizeof(T));
+            return;
+        }
+
+        for (size_type i = index; i < size_; ++i)
+        {
+            if (i < index + count)
+            {
+                alloc_traits::construct(allocator_, data_ + i, std::move(data_[i + count]));
+            }
+            else
+            {
+                data_[i] = std::move(data_[i + count]);
+            }
+        }
+
+        destroy_range(data_ + std::max(size_, index + count), data_ + size_ + count);
+    }
+
+    // Opens a gap of count slots at index and lets fill construct all of
+    // them. fill must leave the gap raw if it throws; the gap is then closed
+    // again, so the vector keeps its old elements.
+    template <typename Fill>
+    constexpr T* fill_gap(size_type index, size_type count, Fill fill)
+    {
+        T* gap = make_gap(index, count);
+
+        try
+        {
+            fill(gap);
+        }
+        catch (...)
+        {
+            close_gap(index, count);
+            throw;
+        }
+
+        size_ += count;
+        return gap;
+    }
+
+    // Growth path of emplace_back. The new element is built before the
+    // reallocation because args may refer to an element that is about to
+    // move.
+    template <typename... Args>
+    CTM_COLD_PATH constexpr reference emplace_back_grow(Args&&... args)
+    {
+        T value(std::forward<Args>(args)...);
+        reallocate(next_capacity_power_of_two(size_ + 1), size_, 0);
+        alloc_traits::construct(allocator_, data_ + size_, std::move(value));
+        return data_[size_++];
+    }
+
+    CTM_COLD_PATH constexpr void grow_to(size_type min_capacity)
+    {
+        reallocate(next_capacity_power_of_two(min_capacity), size_, 0);
+    }
+
+    // Makes room for count more elements and returns the first raw slot.
+    constexpr T* reserve_back(size_type count)
+    {
+        if (count > capacity_ - size_)
+        {
+            grow_to(size_ + count);
+        }
+        return data_ + size_;
+    }
+
+    // destruction is skipped entirely when T has nothing to run
+    constexpr void destroy_range(iterator first, iterator last)
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            while (first != last)
+            {
+                alloc_traits::destroy(allocator_, first);
+                ++first;
+            }
         }
+    }
 
-        if (current_capacity == 0)
+    constexpr size_type next_capacity_power_of_two(size_type new_capacity)
+    {
+        const size_type current_capacity = capacity();
+
+        if (new_capacity  <= current_capacity)
         {
-            return static_cast<size_type>(1);
+            return current_capacity;
         }
 
-        size_type to_change_capacity = 2 * current_capacity;
+        size_type to_change_capacity = (current_capacity == 0) ? 1 : 2 * current_capacity;
 
         while (to_change_capacity < new_capacity)
         {
@@ -618,4 +1104,166 @@ private:
 
 };
 
+namespace detail
+{
+
+#if defined(__AVX2__) && defined(__BMI2__)
+// Removes every element equal to value from [data, data + n) with 8-lane
+// AVX2 stream compaction and returns the new length. The permutation for
+// the kept lanes is derived from the keep mask with pdep/pext instead of a
+// lookup table. Writes never pass the block that was just loaded, so the
+// compaction is safe in place.
+template <typename T>
+std::size_t compact_not_equal_avx2(T* data, std::size_t n, T value)
+{
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8);
+    constexpr std::size_t lanes = 32 / sizeof(T);
+    std::size_t out = 0;
+    std::size_t i = 0;
+
+    for (; i + lanes <= n; i += lanes)
+    {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        unsigned keep = 0;
+
+        if constexpr (std::is_same_v<T, float>)
+        {
+            keep = ~_mm256_movemask_ps(_mm256_cmp_ps(_mm256_castsi256_ps(v),
+                                                     _mm256_set1_ps(value), _CMP_EQ_OQ)) & 0xff;
+        }
+        else if constexpr (std::is_same_v<T, double>)
+        {
+            keep = ~_mm256_movemask_pd(_mm256_cmp_pd(_mm256_castsi256_pd(v),
+                                                     _mm256_set1_pd(value), _CMP_EQ_OQ)) & 0xf;
+        }
+        else if constexpr (sizeof(T) == 4)
+        {
+            keep = ~_mm256_movemask_ps(_mm256_castsi256_ps(
+                       _mm256_cmpeq_epi32(v, _mm256_set1_epi32(static_cast<int>(value))))) & 0xff;
+        }
+        else
+        {
+            keep = ~_mm256_movemask_pd(_mm256_castsi256_pd(
+                       _mm256_cmpeq_epi64(v, _mm256_set1_epi64x(static_cast<long long>(value))))) & 0xf;
+        }
+
+        const std::size_t kept = std::popcount(keep);
+
+        if constexpr (sizeof(T) == 8)
+        {
+            // one keep bit per 64-bit lane becomes two per 32-bit lane
+            keep = _pdep_u32(keep, 0x55) | _pdep_u32(keep, 0xaa);
+        }
+
+        const std::uint64_t byte_mask = _pdep_u64(keep, 0x0101010101010101ULL) * 0xff;
+        const std::uint64_t indices = _pext_u64(0x0706050403020100ULL, byte_mask);
+        const __m256i permutation = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(static_cast<long long>(indices)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + out),
+                            _mm256_permutevar8x32_epi32(v, permutation));
+        out += kept;
+    }
+
+    for (; i < n; ++i)
+    {
+        if (!(data[i] == value))
+        {
+            data[out] = data[i];
+            ++out;
+        }
+    }
+    return out;
+}
+#endif
+
+};
+
+// Removes every element for which pred returns true in a single pass: kept
+// elements are moved down once and the tail is destroyed once. Returns the
+// number of elements removed.
+template <typename T, typename Allocator, typename Pred>
+constexpr typename vector<T, Allocator>::size_type erase_if(vector<T, Allocator>& vec, Pred pred)
+{
+    const auto last = vec.end();
+    auto out = std::find_if(vec.begin(), last, pred);
+
+    if (out == last)
+    {
+        return 0;
+    }
+
+    for (auto it = out + 1; it != last; ++it)
+    {
+        if (!pred(*it))
+        {
+            *out = std::move(*it);
+            ++out;
+        }
+    }
+
+    const auto removed = static_cast<typename vector<T, Allocator>::size_type>(last - out);
+    vec.erase(out, last);
+    return removed;
+}
+
+// Removes every element equal to value. When value has the element type and
+// that type is a 4 or 8 byte arithmetic type, AVX2 stream compaction is used
+// if the build enables AVX2 and BMI2.
+template <typename T, typename Allocator, typename U>
+constexpr typename vector<T, Allocator>::size_type erase(vector<T, Allocator>& vec, const U& value)
+{
+#if defined(__AVX2__) && defined(__BMI2__)
+    if constexpr (std::is_arithmetic_v<T> && (sizeof(T) == 4 || sizeof(T) == 8) &&
+                  std::is_same_v<T, U>)
+    {
+        if (!std::is_constant_evaluated())
+        {
+            const std::size_t kept = detail::compact_not_equal_avx2<T>(vec.data(), vec.size(), value);
+            const auto removed = vec.size() - kept;
+            vec.erase(vec.begin() + kept, vec.end());
+            return removed;
+        }
+    }
+#endif
+
+    return ctm::erase_if(vec, [&value](const T& element) { return element == value; });
+}
+
+// Materialises a range into a ctm::vector, with a single allocation when
+// the range is sized. Usable directly or at the end of a pipeline:
+// auto v = input | std::views::filter(f) | ctm::to_vector();
+template <std::ranges::input_range R>
+constexpr vector<std::ranges::range_value_t<R>> to_vector(R&& range)
+{
+    return vector<std::ranges::range_value_t<R>>(ctm::from_range, std::forward<R>(range));
+}
+
+namespace detail
+{
+
+struct to_vector_closure
+{
+    template <std::ranges::input_range R>
+    friend constexpr auto operator|(R&& range, to_vector_closure)
+    {
+        return ctm::to_vector(std::forward<R>(range));
+    }
+};
+
+};
+
+constexpr detail::to_vector_closure to_vector()
+{
+    return {};
+}
+
+namespace pmr
+{
+
+// Vector whose storage comes from a std::pmr::memory_resource chosen at run
+// time, e.g. a monotonic_buffer_resource or unsynchronized_pool_resource.
+template <typename T>
+using vector = ctm::vector<T, std::pmr::polymorphic_allocator<T>>;
+
+};
+
 };
\ No newline at end of file
@@ -0,0 +1,476 @@
+#pragma once
+
+#include "flat_set.h"
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace ctm
+{
+
+// Sorted associative container keeping keys and mapped values in two
+// parallel ctm::vectors. Lookups binary-search the dense key array only,
+// so values never pollute the cache during a search.
+template <typename Key, typename T, typename Compare = std::less<Key>>
+class flat_map
+{
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using key_compare = Compare;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_container_type = ctm::vector<Key>;
+    using mapped_container_type = ctm::vector<T>;
+
+    template <bool Const>
+    class basic_iterator
+    {
+    public:
+        using map_pointer = std::conditional_t<Const, const flat_map*, flat_map*>;
+        using mapped_reference = std::conditional_t<Const, const T&, T&>;
+        using reference = std::pair<const Key&, mapped_reference>;
+        using difference_type = std::ptrdiff_t;
+        using value_type = std::pair<Key, T>;
+        using iterator_category = std::random_access_iterator_tag;
+
+        struct pointer
+        {
+            reference ref;
+
+            reference* operator->()
+            {
+                return &ref;
+            }
+        };
+
+        basic_iterator():
+            map_(nullptr),
+            index_(0) {}
+
+        basic_iterator(map_pointer map, size_type index):
+            map_(map),
+            index_(index) {}
+
+        // iterator converts to const_iterator
+        template <bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+        basic_iterator(const basic_iterator<OtherConst>& other):
+            map_(other.map_),
+            index_(other.index_) {}
+
+        reference operator*() const
+        {
+            return reference(map_->keys_[index_], map_->values_[index_]);
+        }
+
+        pointer operator->() const
+        {
+            return pointer{**this};
+        }
+
+        reference operator[](difference_type n) const
+        {
+            return *(*this + n);
+        }
+
+        const Key& key() const
+        {
+            return map_->keys_[index_];
+        }
+
+        mapped_reference value() const
+        {
+            return map_->values_[index_];
+        }
+
+        basic_iterator& operator++()
+        {
+            ++index_;
+            return *this;
+        }
+
+        basic_iterator operator++(int)
+        {
+            basic_iterator old = *this;
+            ++index_;
+            return old;
+        }
+
+        basic_iterator& operator--()
+        {
+            --index_;
+            return *this;
+        }
+
+        basic_iterator operator--(int)
+        {
+            basic_iterator old = *this;
+            --index_;
+            return old;
+        }
+
+        basic_iterator& operator+=(difference_type n)
+        {
+            index_ = static_cast<size_type>(static_cast<difference_type>(index_) + n);
+            return *this;
+        }
+
+        basic_iterator& operator-=(difference_type n)
+        {
+            return *this += -n;
+        }
+
+        friend basic_iterator operator+(basic_iterator it, difference_type n)
+        {
+            return it += n;
+        }
+
+        friend basic_iterator operator-(basic_iterator it, difference_type n)
+        {
+            return it -= n;
+        }
+
+        friend difference_type operator-(const basic_iterator& a, const basic_iterator& b)
+        {
+            return static_cast<difference_type>(a.index_) - static_cast<difference_type>(b.index_);
+        }
+
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b)
+        {
+            return a.index_ == b.index_;
+        }
+
+        friend auto operator<=>(const basic_iterator& a, const basic_iterator& b)
+        {
+            return a.index_ <=> b.index_;
+        }
+
+    private:
+        template <bool>
+        friend class basic_iterator;
+        friend class flat_map;
+
+        map_pointer map_;
+        size_type index_;
+    };
+
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    flat_map():
+        keys_(),
+        values_(),
+        comp_() {}
+
+    explicit flat_map(const Compare& comp):
+        keys_(),
+        values_(),
+        comp_(comp) {}
+
+    template <typename InputIt,
+              typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+    flat_map(InputIt first, InputIt last, const Compare& comp = Compare()):
+        flat_map(comp)
+    {
+        insert(first, last);
+    }
+
+    flat_map(std::initializer_list<std::pair<Key, T>> init, const Compare& comp = Compare()):
+        flat_map(init.begin(), init.end(), comp) {}
+
+    // Takes over parallel key and value vectors whose keys are already
+    // sorted by comp and unique; no sort or copy is performed.
+    flat_map(ctm::sorted_unique_t, key_container_type&& keys,
+             mapped_container_type&& values, const Compare& comp = Compare()):
+        flat_map(comp)
+    {
+        if (keys.size() != values.size())
+        {
+            throw std::invalid_argument("flat_map keys and values differ in size");
+        }
+
+        keys_.swap(keys);
+        values_.swap(values);
+    }
+
+    // ITERATORS
+    iterator begin()
+    {
+        return iterator(this, 0);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    iterator end()
+    {
+        return iterator(this, size());
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, size());
+    }
+
+    // CAPACITY
+    bool empty() const
+    {
+        return keys_.empty();
+    }
+
+    size_type size() const
+    {
+        return keys_.size();
+    }
+
+    void reserve(size_type new_capacity)
+    {
+        keys_.reserve(new_capacity);
+        values_.reserve(new_capacity);
+    }
+
+    // LOOKUP
+    iterator lower_bound(const Key& key)
+    {
+        return iterator(this, lower_bound_index(key));
+    }
+
+    const_iterator lower_bound(const Key& key) const
+    {
+        return const_iterator(this, lower_bound_index(key));
+    }
+
+    iterator upper_bound(const Key& key)
+    {
+        return iterator(this, upper_bound_index(key));
+    }
+
+    const_iterator upper_bound(const Key& key) const
+    {
+        return const_iterator(this, upper_bound_index(key));
+    }
+
+    iterator find(const Key& key)
+    {
+        return iterator(this, find_index(key));
+    }
+
+    const_iterator find(const Key& key) const
+    {
+        return const_iterator(this, find_index(key));
+    }
+
+    bool contains(const Key& key) const
+    {
+        return find_index(key) != size();
+    }
+
+    size_type count(const Key& key) const
+    {
+        return contains(key) ? 1 : 0;
+    }
+
+    T& at(const Key& key)
+    {
+        const size_type index = find_index(key);
+
+        if (index == size())
+        {
+            throw std::out_of_range("Key not found");
+        }
+        return values_[index];
+    }
+
+    const T& at(const Key& key) const
+    {
+        const size_type index = find_index(key);
+
+        if (index == size())
+        {
+            throw std::out_of_range("Key not found");
+        }
+        return values_[index];
+    }
+
+    T& operator[](const Key& key)
+    {
+        return try_emplace(key).first.value();
+    }
+
+    // MODIFIERS
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args)
+    {
+        const size_type index = lower_bound_index(key);
+
+        if (index != size() && !comp_(key, keys_[index]))
+        {
+            return {iterator(this, index), false};
+        }
+
+        insert_at(index, key, T(std::forward<Args>(args)...));
+        return {iterator(this, index), true};
+    }
+
+    std::pair<iterator, bool> insert(const std::pair<Key, T>& kv)
+    {
+        return try_emplace(kv.first, kv.second);
+    }
+
+    std::pair<iterator, bool> insert_or_assign(const Key& key, const T& value)
+    {
+        auto result = try_emplace(key, value);
+
+        if (!result.second)
+        {
+            result.first.value() = value;
+        }
+        return result;
+    }
+
+    // Sorts only the batch (stably, so the first of duplicate keys wins) and
+    // merges it with the existing entries in one linear pass. Keys already
+    // present keep their value.
+    template <typename InputIt,
+              typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+    void insert(InputIt first, InputIt last)
+    {
+        ctm::vector<std::pair<Key, T>> batch(first, last);
+        std::stable_sort(batch.begin(), batch.end(),
+            [this](const std::pair<Key, T>& a, const std::pair<Key, T>& b) { return comp_(a.first, b.first); });
+
+        key_container_type merged_keys;
+        mapped_container_type merged_values;
+        merged_keys.reserve(keys_.size() + batch.size());
+        merged_values.reserve(keys_.size() + batch.size());
+        size_type a = 0;
+        size_type b = 0;
+
+        while (a < keys_.size() || b < batch.size())
+        {
+            const bool take_a = b == batch.size() ||
+                                (a < keys_.size() && !comp_(batch[b].first, keys_[a]));
+            Key& key = take_a ? keys_[a] : batch[b].first;
+
+            if (merged_keys.empty() || comp_(merged_keys.back(), key))
+            {
+                if (!take_a)
+                {
+                    merged_keys.push_back(std::move(key));
+                    merged_values.push_back(std::move(batch[b].second));
+                }
+                else if constexpr (nothrow_merge)
+                {
+                    merged_keys.push_back(std::move(key));
+                    merged_values.push_back(std::move(values_[a]));
+                }
+                else
+                {
+                    merged_keys.push_back(std::as_const(key));
+                    merged_values.push_back(std::as_const(values_[a]));
+                }
+            }
+
+            if (take_a)
+            {
+                ++a;
+            }
+            else
+            {
+                ++b;
+            }
+        }
+
+        keys_.swap(merged_keys);
+        values_.swap(merged_values);
+    }
+
+    void insert(std::initializer_list<std::pair<Key, T>> ilist)
+    {
+        insert(ilist.begin(), ilist.end());
+    }
+
+    size_type erase(const Key& key)
+    {
+        const size_type index = find_index(key);
+
+        if (index == size())
+        {
+            return 0;
+        }
+
+        erase(const_iterator(this, index));
+        return 1;
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        keys_.erase(keys_.begin() + pos.index_);
+        values_.erase(values_.begin() + pos.index_);
+        return iterator(this, pos.index_);
+    }
+
+    void clear()
+    {
+        keys_.clear();
+        values_.clear();
+    }
+
+    const key_container_type& keys() const
+    {
+        return keys_;
+    }
+
+    const mapped_container_type& values() const
+    {
+        return values_;
+    }
+
+private:
+    key_container_type keys_;
+    mapped_container_type values_;
+    Compare comp_;
+
+    // Existing entries are moved into a merge only when no step of it can
+    // throw; otherwise they are copied, so a failed merge leaves the map as
+    // it was.
+    static constexpr bool nothrow_merge =
+        std::is_nothrow_move_constructible_v<Key> && std::is_nothrow_move_constructible_v<T>;
+
+    size_type lower_bound_index(const Key& key) const
+    {
+        return static_cast<size_type>(
+            detail::flat_lower_bound(keys_.begin(), keys_.size(), key, comp_) - keys_.begin());
+    }
+
+    size_type upper_bound_index(const Key& key) const
+    {
+        return static_cast<size_type>(
+            detail::flat_upper_bound(keys_.begin(), keys_.size(), key, comp_) - keys_.begin());
+    }
+
+    size_type find_index(const Key& key) const
+    {
+        const size_type index = lower_bound_index(key);
+        return (index != size() && !comp_(key, keys_[index])) ? index : size();
+    }
+
+    void insert_at(size_type index, const Key& key, T&& value)
+    {
+        keys_.insert(keys_.begin() + index, key);
+
+        try
+        {
+            values_.insert(values_.begin() + index, std::move(value));
+        }
+        catch (...)
+        {
+            keys_.erase(keys_.begin() + index);
+            throw;
+        }
+    }
+};
+
+};
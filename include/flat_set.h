@@ -0,0 +1,250 @@
+#pragma once
+
+#include "custom_vector.h"
+#include <functional>
+#include <utility>
+
+namespace ctm
+{
+
+// Tag for adopting storage that is already sorted and free of duplicates.
+struct sorted_unique_t
+{
+    explicit sorted_unique_t() = default;
+};
+
+inline constexpr sorted_unique_t sorted_unique{};
+
+namespace detail
+{
+
+// Branchless lower bound: the loop body compiles to a conditional move, so
+// lookups cost one cache miss per level and no branch mispredictions.
+template <typename It, typename K, typename Compare>
+constexpr It flat_lower_bound(It first, std::size_t n, const K& key, Compare comp)
+{
+    if (n == 0)
+    {
+        return first;
+    }
+
+    while (n > 1)
+    {
+        const std::size_t half = n / 2;
+        first = comp(first[half], key) ? first + half : first;
+        n -= half;
+    }
+    return first + static_cast<std::ptrdiff_t>(comp(*first, key));
+}
+
+template <typename It, typename K, typename Compare>
+constexpr It flat_upper_bound(It first, std::size_t n, const K& key, Compare comp)
+{
+    return flat_lower_bound(first, n, key,
+        [&comp](const auto& element, const K& k) { return !comp(k, element); });
+}
+
+};
+
+// Sorted set of unique keys stored contiguously in a ctm::vector.
+template <typename Key, typename Compare = std::less<Key>>
+class flat_set
+{
+public:
+    using key_type = Key;
+    using value_type = Key;
+    using key_compare = Compare;
+    using size_type = std::size_t;
+    using container_type = ctm::vector<Key>;
+    using iterator = typename container_type::const_iterator;
+    using const_iterator = typename container_type::const_iterator;
+
+    flat_set():
+        keys_(),
+        comp_() {}
+
+    explicit flat_set(const Compare& comp):
+        keys_(),
+        comp_(comp) {}
+
+    template <typename InputIt,
+              typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+    flat_set(InputIt first, InputIt last, const Compare& comp = Compare()):
+        keys_(),
+        comp_(comp)
+    {
+        insert(first, last);
+    }
+
+    flat_set(std::initializer_list<Key> init, const Compare& comp = Compare()):
+        flat_set(init.begin(), init.end(), comp) {}
+
+    // Takes over keys that are already sorted by comp and unique; no sort or
+    // copy is performed.
+    flat_set(ctm::sorted_unique_t, container_type&& keys, const Compare& comp = Compare()):
+        keys_(),
+        comp_(comp)
+    {
+        keys_.swap(keys);
+    }
+
+    // ITERATORS
+    const_iterator begin() const
+    {
+        return keys_.begin();
+    }
+
+    const_iterator end() const
+    {
+        return keys_.end();
+    }
+
+    // CAPACITY
+    bool empty() const
+    {
+        return keys_.empty();
+    }
+
+    size_type size() const
+    {
+        return keys_.size();
+    }
+
+    void reserve(size_type new_capacity)
+    {
+        keys_.reserve(new_capacity);
+    }
+
+    // LOOKUP
+    const_iterator lower_bound(const Key& key) const
+    {
+        return detail::flat_lower_bound(keys_.begin(), keys_.size(), key, comp_);
+    }
+
+    const_iterator upper_bound(const Key& key) const
+    {
+        return detail::flat_upper_bound(keys_.begin(), keys_.size(), key, comp_);
+    }
+
+    const_iterator find(const Key& key) const
+    {
+        const_iterator it = lower_bound(key);
+        return (it != end() && !comp_(key, *it)) ? it : end();
+    }
+
+    bool contains(const Key& key) const
+    {
+        return find(key) != end();
+    }
+
+    size_type count(const Key& key) const
+    {
+        return contains(key) ? 1 : 0;
+    }
+
+    // MODIFIERS
+    std::pair<iterator, bool> insert(const Key& key)
+    {
+        const_iterator it = lower_bound(key);
+
+        if (it != end() && !comp_(key, *it))
+        {
+            return {it, false};
+        }
+
+        return {keys_.insert(it, key), true};
+    }
+
+    // Appends the batch, sorts only the batch and merges it with the existing
+    // keys in one linear pass. Keys already present are kept.
+    template <typename InputIt,
+              typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+    void insert(InputIt first, InputIt last)
+    {
+        container_type batch(first, last);
+        std::stable_sort(batch.begin(), batch.end(), comp_);
+
+        container_type merged;
+        merged.reserve(keys_.size() + batch.size());
+        auto a = keys_.begin();
+        auto b = batch.begin();
+
+        while (a != keys_.end() || b != batch.end())
+        {
+            const bool take_a = b == batch.end() || (a != keys_.end() && !comp_(*b, *a));
+            Key& next = take_a ? *a : *b;
+
+            if (merged.empty() || comp_(merged.back(), next))
+            {
+                // existing keys are only moved when that cannot throw, so a
+                // failed merge leaves the set as it was
+                if (take_a)
+                {
+                    merged.push_back(std::move_if_noexcept(next));
+                }
+                else
+                {
+                    merged.push_back(std::move(next));
+                }
+            }
+
+            if (take_a)
+            {
+                ++a;
+            }
+            else
+            {
+                ++b;
+            }
+        }
+
+        keys_.swap(merged);
+    }
+
+    void insert(std::initializer_list<Key> ilist)
+    {
+        insert(ilist.begin(), ilist.end());
+    }
+
+    size_type erase(const Key& key)
+    {
+        const_iterator it = find(key);
+
+        if (it == end())
+        {
+            return 0;
+        }
+
+        erase(it);
+        return 1;
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        return keys_.erase(pos);
+    }
+
+    void clear()
+    {
+        keys_.clear();
+    }
+
+    const container_type& keys() const
+    {
+        return keys_;
+    }
+
+    // Moves the sorted keys out, leaving the set empty.
+    container_type extract()
+    {
+        container_type out;
+        out.swap(keys_);
+        return out;
+    }
+
+private:
+    container_type keys_;
+    Compare comp_;
+};
+
+};
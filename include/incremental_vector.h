@@ -0,0 +1,519 @@
+#pragma once
+
+#include "custom_allocator.h"
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace ctm
+{
+
+// Vector with de-amortised growth for bounded append latency. When full it
+// allocates a buffer twice as large but does not copy: elements [0,
+// pending) stay in the old buffer and each push_back moves a few of them
+// across, from the top down. Every push_back is O(1) in the worst case, and
+// operator[] picks the buffer with a single comparison.
+//
+// The storage is only contiguous once migration has finished; data()
+// finishes it first.
+template <typename T, typename Allocator = ctm::allocator<T>>
+class incremental_vector
+{
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using allocator_type = Allocator;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+
+    // Old elements moved per push_back. Any value of at least 2 finishes a
+    // migration before the new buffer fills up.
+    static constexpr size_type migrate_per_push = 4;
+
+    template <bool Const>
+    class basic_iterator
+    {
+    public:
+        using owner_pointer = std::conditional_t<Const, const incremental_vector*, incremental_vector*>;
+        using value_type = T;
+        using reference = std::conditional_t<Const, const T&, T&>;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::random_access_iterator_tag;
+
+        basic_iterator():
+            owner_(nullptr),
+            index_(0) {}
+
+        basic_iterator(owner_pointer owner, size_type index):
+            owner_(owner),
+            index_(index) {}
+
+        // iterator converts to const_iterator
+        template <bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+        basic_iterator(const basic_iterator<OtherConst>& other):
+            owner_(other.owner_),
+            index_(other.index_) {}
+
+        reference operator*() const
+        {
+            return (*owner_)[index_];
+        }
+
+        pointer operator->() const
+        {
+            return &(*owner_)[index_];
+        }
+
+        reference operator[](difference_type n) const
+        {
+            return *(*this + n);
+        }
+
+        basic_iterator& operator++()
+        {
+            ++index_;
+            return *this;
+        }
+
+        basic_iterator operator++(int)
+        {
+            basic_iterator old = *this;
+            ++index_;
+            return old;
+        }
+
+        basic_iterator& operator--()
+        {
+            --index_;
+            return *this;
+        }
+
+        basic_iterator operator--(int)
+        {
+            basic_iterator old = *this;
+            --index_;
+            return old;
+        }
+
+        basic_iterator& operator+=(difference_type n)
+        {
+            index_ = static_cast<size_type>(static_cast<difference_type>(index_) + n);
+            return *this;
+        }
+
+        basic_iterator& operator-=(difference_type n)
+        {
+            return *this += -n;
+        }
+
+        friend basic_iterator operator+(basic_iterator it, difference_type n)
+        {
+            return it += n;
+        }
+
+        friend basic_iterator operator+(difference_type n, basic_iterator it)
+        {
+            return it += n;
+        }
+
+        friend basic_iterator operator-(basic_iterator it, difference_type n)
+        {
+            return it -= n;
+        }
+
+        friend difference_type operator-(const basic_iterator& a, const basic_iterator& b)
+        {
+            return static_cast<difference_type>(a.index_) - static_cast<difference_type>(b.index_);
+        }
+
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b)
+        {
+            return a.index_ == b.index_;
+        }
+
+        friend auto operator<=>(const basic_iterator& a, const basic_iterator& b)
+        {
+            return a.index_ <=> b.index_;
+        }
+
+    private:
+        template <bool>
+        friend class basic_iterator;
+
+        owner_pointer owner_;
+        size_type index_;
+    };
+
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    incremental_vector():
+        incremental_vector(Allocator()) {}
+
+    explicit incremental_vector(const Allocator& alloc):
+        data_(nullptr),
+        size_(0),
+        capacity_(0),
+        old_(nullptr),
+        old_capacity_(0),
+        pending_(0),
+        allocator_(alloc) {}
+
+    template <typename InputIt,
+              typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+    incremental_vector(InputIt first, InputIt last, const Allocator& alloc = Allocator()):
+        incremental_vector(alloc)
+    {
+        for (; first != last; ++first)
+        {
+            push_back(*first);
+        }
+    }
+
+    incremental_vector(std::initializer_list<T> init, const Allocator& alloc = Allocator()):
+        incremental_vector(init.begin(), init.end(), alloc) {}
+
+    incremental_vector(const incremental_vector& other):
+        incremental_vector(alloc_traits::select_on_container_copy_construction(other.allocator_))
+    {
+        reserve(other.size_);
+
+        for (const T& value : other)
+        {
+            push_back(value);
+        }
+    }
+
+    incremental_vector(incremental_vector&& other) noexcept:
+        data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)),
+        capacity_(std::exchange(other.capacity_, 0)),
+        old_(std::exchange(other.old_, nullptr)),
+        old_capacity_(std::exchange(other.old_capacity_, 0)),
+        pending_(std::exchange(other.pending_, 0)),
+        allocator_(other.allocator_) {}
+
+    incremental_vector& operator=(const incremental_vector& other)
+    {
+        if (this != &other)
+        {
+            incremental_vector copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    incremental_vector& operator=(incremental_vector&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release_memory();
+            swap(other);
+        }
+        return *this;
+    }
+
+    ~incremental_vector()
+    {
+        release_memory();
+    }
+
+    // ELEMENT ACCESS
+    reference at(size_type index)
+    {
+        if (index >= size_)
+        {
+            throw std::out_of_range("Indexing out of range");
+        }
+        return (*this)[index];
+    }
+
+    const_reference at(size_type index) const
+    {
+        if (index >= size_)
+        {
+            throw std::out_of_range("Indexing out of range");
+        }
+        return (*this)[index];
+    }
+
+    reference operator[](size_type index)
+    {
+        return index < pending_ ? old_[index] : data_[index];
+    }
+
+    const_reference operator[](size_type index) const
+    {
+        return index < pending_ ? old_[index] : data_[index];
+    }
+
+    reference front()
+    {
+        return (*this)[0];
+    }
+
+    const_reference front() const
+    {
+        return (*this)[0];
+    }
+
+    reference back()
+    {
+        return (*this)[size_ - 1];
+    }
+
+    const_reference back() const
+    {
+        return (*this)[size_ - 1];
+    }
+
+    // Contiguous storage; completes any migration in progress, which costs
+    // O(size()) once.
+    T* data()
+    {
+        finish_migration();
+        return data_;
+    }
+
+    // ITERATORS
+    iterator begin()
+    {
+        return iterator(this, 0);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    iterator end()
+    {
+        return iterator(this, size_);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, size_);
+    }
+
+    // CAPACITY
+    bool empty() const
+    {
+        return (size_ == 0);
+    }
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+    size_type capacity() const
+    {
+        return capacity_;
+    }
+
+    // True while some elements still live in the previous buffer.
+    bool migrating() const
+    {
+        return old_ != nullptr;
+    }
+
+    void finish_migration()
+    {
+        if (old_)
+        {
+            migrate(pending_);
+        }
+    }
+
+    // Grows eagerly: completes migration and moves everything at once.
+    void reserve(size_type new_capacity)
+    {
+        if (new_capacity <= capacity_)
+        {
+            return;
+        }
+
+        finish_migration();
+        T* new_data = alloc_traits::allocate(allocator_, new_capacity);
+        relocate(data_, size_, new_data);
+        free_buffer(data_, capacity_);
+        data_ = new_data;
+        capacity_ = new_capacity;
+    }
+
+    // Destroys every element and frees both buffers.
+    void release_memory()
+    {
+        clear();
+        free_buffer(data_, capacity_);
+        data_ = nullptr;
+        capacity_ = 0;
+    }
+
+    // MODIFIERS
+    void clear()
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            for (size_type i = 0; i < size_; ++i)
+            {
+                alloc_traits::destroy(allocator_, &(*this)[i]);
+            }
+        }
+
+        size_ = 0;
+        pending_ = 0;
+        free_old();
+    }
+
+    void push_back(const T& value)
+    {
+        emplace_back(value);
+    }
+
+    void push_back(T&& value)
+    {
+        emplace_back(std::move(value));
+    }
+
+    template <typename... Args>
+    reference emplace_back(Args&&... args)
+    {
+        if (size_ == capacity_)
+        {
+            start_migration();
+        }
+
+        // construct before migrating, as args may refer to a pending element
+        alloc_traits::construct(allocator_, data_ + size_, std::forward<Args>(args)...);
+        ++size_;
+
+        if (old_)
+        {
+            migrate(std::min(migrate_per_push, pending_));
+        }
+        return data_[size_ - 1];
+    }
+
+    void pop_back()
+    {
+        if (size_ == 0)
+        {
+            return;
+        }
+
+        --size_;
+        alloc_traits::destroy(allocator_, &(*this)[size_]);
+
+        if (size_ < pending_)
+        {
+            pending_ = size_;
+
+            if (pending_ == 0)
+            {
+                free_old();
+            }
+        }
+    }
+
+    void swap(incremental_vector& other) noexcept
+    {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(old_, other.old_);
+        std::swap(old_capacity_, other.old_capacity_);
+        std::swap(pending_, other.pending_);
+    }
+
+    friend bool operator==(const incremental_vector& a, const incremental_vector& b)
+    {
+        return a.size_ == b.size_ && std::equal(a.begin(), a.end(), b.begin());
+    }
+
+private:
+    using alloc_traits = std::allocator_traits<Allocator>;
+
+    // elements [0, pending_) live in old_, the rest in data_
+    T* data_;
+    size_type size_;
+    size_type capacity_;
+    T* old_;
+    size_type old_capacity_;
+    size_type pending_;
+    Allocator allocator_;
+
+    void start_migration()
+    {
+        finish_migration();
+        const size_type new_capacity = capacity_ == 0 ? 1 : 2 * capacity_;
+        old_ = data_;
+        old_capacity_ = capacity_;
+        pending_ = size_;
+        data_ = alloc_traits::allocate(allocator_, new_capacity);
+        capacity_ = new_capacity;
+
+        if (pending_ == 0)
+        {
+            free_old();
+        }
+    }
+
+    // Moves the top count pending elements into the new buffer.
+    void migrate(size_type count)
+    {
+        pending_ -= count;
+        relocate(old_ + pending_, count, data_ + pending_);
+
+        if (pending_ == 0)
+        {
+            free_old();
+        }
+    }
+
+    void relocate(T* src, size_type count, T* dst)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            std::memcpy(static_cast<void*>(dst), src, count * sizeof(T));
+        }
+        else
+        {
+            for (size_type i = 0; i < count; ++i)
+            {
+                alloc_traits::construct(allocator_, dst + i, std::move(src[i]));
+                alloc_traits::destroy(allocator_, src + i);
+            }
+        }
+    }
+
+    void free_buffer(T* buffer, size_type capacity)
+    {
+        if (buffer)
+        {
+            alloc_traits::deallocate(allocator_, buffer, capacity);
+        }
+    }
+
+    void free_old()
+    {
+        free_buffer(old_, old_capacity_);
+        old_ = nullptr;
+        old_capacity_ = 0;
+    }
+};
+
+};
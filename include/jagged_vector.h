@@ -0,0 +1,432 @@
+#pragma once
+
+#include "custom_vector.h"
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+
+namespace ctm
+{
+
+// Array of variable-length rows in compressed sparse row layout: every
+// value lives in one contiguous ctm::vector and row i is the slice
+// [offsets[i], offsets[i + 1]). Replaces a vector of separately allocated
+// vectors with two allocations and sequential row-by-row traversal.
+template <typename T>
+class jagged_vector
+{
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using row_type = std::span<T>;
+    using const_row_type = std::span<const T>;
+
+    template <bool Const>
+    class basic_iterator
+    {
+    public:
+        using owner_pointer = std::conditional_t<Const, const jagged_vector*, jagged_vector*>;
+        using value_type = std::conditional_t<Const, const_row_type, row_type>;
+        using reference = value_type;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::random_access_iterator_tag;
+
+        basic_iterator():
+            owner_(nullptr),
+            row_(0) {}
+
+        basic_iterator(owner_pointer owner, size_type row):
+            owner_(owner),
+            row_(row) {}
+
+        reference operator*() const
+        {
+            return (*owner_)[row_];
+        }
+
+        reference operator[](difference_type n) const
+        {
+            return (*owner_)[static_cast<size_type>(static_cast<difference_type>(row_) + n)];
+        }
+
+        basic_iterator& operator++()
+        {
+            ++row_;
+            return *this;
+        }
+
+        basic_iterator operator++(int)
+        {
+            basic_iterator old = *this;
+            ++row_;
+            return old;
+        }
+
+        basic_iterator& operator--()
+        {
+            --row_;
+            return *this;
+        }
+
+        basic_iterator operator--(int)
+        {
+            basic_iterator old = *this;
+            --row_;
+            return old;
+        }
+
+        basic_iterator& operator+=(difference_type n)
+        {
+            row_ = static_cast<size_type>(static_cast<difference_type>(row_) + n);
+            return *this;
+        }
+
+        basic_iterator& operator-=(difference_type n)
+        {
+            return *this += -n;
+        }
+
+        friend basic_iterator operator+(basic_iterator it, difference_type n)
+        {
+            return it += n;
+        }
+
+        friend basic_iterator operator-(basic_iterator it, difference_type n)
+        {
+            return it -= n;
+        }
+
+        friend difference_type operator-(const basic_iterator& a, const basic_iterator& b)
+        {
+            return static_cast<difference_type>(a.row_) - static_cast<difference_type>(b.row_);
+        }
+
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b)
+        {
+            return a.row_ == b.row_;
+        }
+
+        friend auto operator<=>(const basic_iterator& a, const basic_iterator& b)
+        {
+            return a.row_ <=> b.row_;
+        }
+
+    private:
+        owner_pointer owner_;
+        size_type row_;
+    };
+
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    // Collects (row, value) pairs in any order and lays them out in one
+    // counting-sort pass. Values keep their insertion order within a row.
+    class builder
+    {
+    public:
+        explicit builder(size_type rows = 0):
+            rows_(rows),
+            row_of_(),
+            values_() {}
+
+        void reserve(size_type count)
+        {
+            row_of_.reserve(count);
+            values_.reserve(count);
+        }
+
+        void add(size_type row, const T& value)
+        {
+            row_of_.push_back(row);
+            values_.push_back(value);
+            rows_ = std::max(rows_, row + 1);
+        }
+
+        void add(size_type row, T&& value)
+        {
+            row_of_.push_back(row);
+            values_.push_back(std::move(value));
+            rows_ = std::max(rows_, row + 1);
+        }
+
+        size_type size() const
+        {
+            return values_.size();
+        }
+
+        // Builds the rows and leaves the builder empty.
+        jagged_vector build()
+        {
+            jagged_vector out;
+            out.offsets_.resize(rows_ + 1, 0);
+
+            for (size_type i = 0; i < row_of_.size(); ++i)
+            {
+                ++out.offsets_[row_of_[i] + 1];
+            }
+
+            for (size_type row = 0; row < rows_; ++row)
+            {
+                out.offsets_[row + 1] += out.offsets_[row];
+            }
+
+            // position of the i-th value in the final layout
+            ctm::vector<std::uint64_t> next(out.offsets_.begin(), out.offsets_.end() - 1);
+            ctm::vector<std::uint64_t> order(values_.size());
+
+            for (size_type i = 0; i < row_of_.size(); ++i)
+            {
+                order[next[row_of_[i]]++] = i;
+            }
+
+            out.values_.reserve(values_.size());
+
+            for (size_type i = 0; i < order.size(); ++i)
+            {
+                out.values_.push_back(std::move(values_[order[i]]));
+            }
+
+            rows_ = 0;
+            row_of_.release_memory();
+            values_.release_memory();
+            return out;
+        }
+
+    private:
+        size_type rows_;
+        ctm::vector<size_type> row_of_;
+        ctm::vector<T> values_;
+    };
+
+    jagged_vector():
+        values_(),
+        offsets_{0} {}
+
+    // Flattens a vector of vectors, allocating exactly once for the values.
+    explicit jagged_vector(const ctm::vector<ctm::vector<T>>& nested):
+        jagged_vector()
+    {
+        size_type total = 0;
+
+        for (const ctm::vector<T>& row : nested)
+        {
+            total += row.size();
+        }
+
+        reserve(nested.size(), total);
+
+        for (const ctm::vector<T>& row : nested)
+        {
+            append_row(row);
+        }
+    }
+
+    jagged_vector(std::initializer_list<std::initializer_list<T>> rows):
+        jagged_vector()
+    {
+        for (std::initializer_list<T> row : rows)
+        {
+            append_row(row);
+        }
+    }
+
+    // ELEMENT ACCESS
+    row_type operator[](size_type row)
+    {
+        return row_type(values_.data() + offsets_[row], row_size(row));
+    }
+
+    const_row_type operator[](size_type row) const
+    {
+        return const_row_type(values_.data() + offsets_[row], row_size(row));
+    }
+
+    row_type at(size_type row)
+    {
+        if (row >= rows())
+        {
+            throw std::out_of_range("Indexing out of range");
+        }
+        return (*this)[row];
+    }
+
+    const_row_type at(size_type row) const
+    {
+        if (row >= rows())
+        {
+            throw std::out_of_range("Indexing out of range");
+        }
+        return (*this)[row];
+    }
+
+    row_type front()
+    {
+        return (*this)[0];
+    }
+
+    row_type back()
+    {
+        return (*this)[rows() - 1];
+    }
+
+    const ctm::vector<T>& values() const
+    {
+        return values_;
+    }
+
+    const ctm::vector<std::uint64_t>& offsets() const
+    {
+        return offsets_;
+    }
+
+    // ITERATORS
+    iterator begin()
+    {
+        return iterator(this, 0);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    iterator end()
+    {
+        return iterator(this, rows());
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, rows());
+    }
+
+    // CAPACITY
+    bool empty() const
+    {
+        return (rows() == 0);
+    }
+
+    // Number of rows.
+    size_type rows() const
+    {
+        return offsets_.size() - 1;
+    }
+
+    size_type size() const
+    {
+        return rows();
+    }
+
+    size_type row_size(size_type row) const
+    {
+        return static_cast<size_type>(offsets_[row + 1] - offsets_[row]);
+    }
+
+    // Total number of values across all rows.
+    size_type value_count() const
+    {
+        return values_.size();
+    }
+
+    void reserve(size_type rows, size_type values)
+    {
+        offsets_.reserve(rows + 1);
+        values_.reserve(values);
+    }
+
+    void shrink_to_fit()
+    {
+        offsets_.shrink_to_fit();
+        values_.shrink_to_fit();
+    }
+
+    // MODIFIERS
+    template <std::ranges::input_range R>
+    row_type append_row(R&& row)
+    {
+        const size_type start = values_.size();
+
+        // grows geometrically; sized rows are copied in bulk
+        values_.append_range(std::forward<R>(row));
+        offsets_.push_back(values_.size());
+        return row_type(values_.data() + start, values_.size() - start);
+    }
+
+    row_type append_row(std::initializer_list<T> row)
+    {
+        return append_row(std::span<const T>(row.begin(), row.size()));
+    }
+
+    // Appends a row of count copies of value.
+    row_type append_row(size_type count, const T& value = T())
+    {
+        const size_type start = values_.size();
+        values_.resize(start + count, value);
+        offsets_.push_back(values_.size());
+        return row_type(values_.data() + start, count);
+    }
+
+    // Appends value to the last row.
+    void push_back_to_last(const T& value)
+    {
+        if (empty())
+        {
+            throw std::out_of_range("jagged_vector has no rows");
+        }
+
+        values_.push_back(value);
+        ++offsets_.back();
+    }
+
+    void pop_row()
+    {
+        if (empty())
+        {
+            return;
+        }
+
+        offsets_.pop_back();
+        values_.resize(offsets_.back());
+    }
+
+    void clear()
+    {
+        values_.clear();
+        offsets_.resize(1);
+    }
+
+    void swap(jagged_vector& other)
+    {
+        values_.swap(other.values_);
+        offsets_.swap(other.offsets_);
+    }
+
+    ctm::vector<ctm::vector<T>> to_nested() const
+    {
+        ctm::vector<ctm::vector<T>> nested;
+        nested.reserve(rows());
+
+        for (const_row_type row : *this)
+        {
+            nested.push_back(ctm::vector<T>(row.begin(), row.end()));
+        }
+        return nested;
+    }
+
+    friend bool operator==(const jagged_vector& a, const jagged_vector& b)
+    {
+        return a.offsets_.size() == b.offsets_.size() && a.values_.size() == b.values_.size() &&
+               std::equal(a.offsets_.begin(), a.offsets_.end(), b.offsets_.begin()) &&
+               std::equal(a.values_.begin(), a.values_.end(), b.values_.begin());
+    }
+
+private:
+    ctm::vector<T> values_;
+    // rows() + 1 entries; offsets_[0] is always 0
+    ctm::vector<std::uint64_t> offsets_;
+};
+
+};
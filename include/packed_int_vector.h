@@ -0,0 +1,407 @@
+#pragma once
+
+#include "custom_vector.h"
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace ctm
+{
+
+enum class packing
+{
+    plain,              // values stored as-is
+    frame_of_reference, // values stored relative to the minimum of their block
+    delta               // non-decreasing input stored as gaps within each block
+};
+
+// Unsigned integers stored at a fixed bit width. Width is either fixed at
+// compile time (Width != 0) or chosen from the data on construction and
+// widened by push_back when a larger value arrives.
+//
+// In frame_of_reference and delta mode every block_size values share a
+// 64-bit base. frame_of_reference keeps O(1) random access; delta needs
+// a prefix sum inside the block but gives the smallest widths for sorted
+// ID and posting lists.
+template <unsigned Width = 0>
+class packed_int_vector
+{
+public:
+    using value_type = std::uint64_t;
+    using size_type = std::size_t;
+
+    static constexpr size_type block_size = 128;
+
+    static_assert(Width <= 64, "bit width must not exceed 64");
+
+    explicit packed_int_vector(ctm::packing mode = ctm::packing::plain):
+        words_(),
+        bases_(),
+        size_(0),
+        width_(Width == 0 ? 1 : Width),
+        mode_(mode)
+    {
+        words_.push_back(0);
+    }
+
+    packed_int_vector(const ctm::vector<value_type>& values,
+                      ctm::packing mode = ctm::packing::plain):
+        packed_int_vector(values.begin(), values.end(), mode) {}
+
+    template <typename InputIt,
+              typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+    packed_int_vector(InputIt first, InputIt last,
+                      ctm::packing mode = ctm::packing::plain):
+        packed_int_vector(mode)
+    {
+        const ctm::vector<value_type> values(first, last);
+        build(values);
+    }
+
+    // ELEMENT ACCESS
+    value_type operator[](size_type index) const
+    {
+        if (mode_ == ctm::packing::plain)
+        {
+            return read_packed(index);
+        }
+
+        const size_type block = index / block_size;
+
+        if (mode_ == ctm::packing::frame_of_reference)
+        {
+            return bases_[block] + read_packed(index);
+        }
+
+        value_type value = bases_[block];
+
+        for (size_type i = block * block_size + 1; i <= index; ++i)
+        {
+            value += read_packed(i);
+        }
+        return value;
+    }
+
+    value_type at(size_type index) const
+    {
+        if (index >= size_)
+        {
+            throw std::out_of_range("Indexing out of range");
+        }
+        return (*this)[index];
+    }
+
+    // CAPACITY
+    bool empty() const
+    {
+        return (size_ == 0);
+    }
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+    unsigned bit_width() const
+    {
+        return width();
+    }
+
+    ctm::packing mode() const
+    {
+        return mode_;
+    }
+
+    // Bytes held by the packed words and block bases.
+    size_type memory_bytes() const
+    {
+        return (words_.size() + bases_.size()) * sizeof(value_type);
+    }
+
+    // MODIFIERS
+    // Only plain vectors can grow one value at a time. An auto-width vector
+    // repacks its values when one needs more bits; with a fixed Width the
+    // value must fit.
+    void push_back(value_type value)
+    {
+        if (mode_ != ctm::packing::plain)
+        {
+            throw std::logic_error("push_back requires ctm::packing::plain");
+        }
+
+        if (width() < 64 && (value >> width()) != 0)
+        {
+            if constexpr (Width != 0)
+            {
+                throw std::out_of_range("Value does not fit the packed bit width");
+            }
+            else
+            {
+                widen(static_cast<unsigned>(std::bit_width(value)));
+            }
+        }
+
+        ++size_;
+        words_.resize(words_for(size_));
+        write_packed(size_ - 1, value);
+    }
+
+    void clear()
+    {
+        words_.clear();
+        words_.push_back(0);
+        bases_.clear();
+        size_ = 0;
+    }
+
+    // BULK DECODE
+    // Replaces the contents of out with all values. Values must fit in 32
+    // bits; the AVX2 path unpacks four values per iteration.
+    void decode(ctm::vector<std::uint32_t>& out) const
+    {
+        decode_into(out);
+    }
+
+    void decode(ctm::vector<value_type>& out) const
+    {
+        decode_into(out);
+    }
+
+private:
+    // One trailing padding word keeps the two-word read in read_packed in
+    // bounds for the last value.
+    ctm::vector<value_type> words_;
+    ctm::vector<value_type> bases_;
+    size_type size_;
+    unsigned width_;
+    ctm::packing mode_;
+
+    unsigned width() const
+    {
+        if constexpr (Width != 0)
+        {
+            return Width;
+        }
+        else
+        {
+            return width_;
+        }
+    }
+
+    value_type mask() const
+    {
+        return width() == 64 ? ~value_type(0) : (value_type(1) << width()) - 1;
+    }
+
+    size_type words_for(size_type count) const
+    {
+        return (count * width() + 63) / 64 + 1;
+    }
+
+    value_type read_packed(size_type index) const
+    {
+        const size_type bit = index * width();
+        const size_type word = bit / 64;
+        const unsigned shift = bit % 64;
+        // the double shift keeps the high part well defined when shift == 0
+        const value_type lo = words_[word] >> shift;
+        const value_type hi = (words_[word + 1] << 1) << (63 - shift);
+        return (lo | hi) & mask();
+    }
+
+    void write_packed(size_type index, value_type value)
+    {
+        const size_type bit = index * width();
+        const size_type word = bit / 64;
+        const unsigned shift = bit % 64;
+        const value_type m = mask();
+
+        words_[word] = (words_[word] & ~(m << shift)) | (value << shift);
+
+        if (shift + width() > 64)
+        {
+            const unsigned spill = 64 - shift;
+            words_[word + 1] = (words_[word + 1] & ~(m >> spill)) | (value >> spill);
+        }
+    }
+
+    // Repacks every value at new_width. Nothing changes if an allocation
+    // throws.
+    void widen(unsigned new_width)
+    {
+        ctm::vector<value_type> values;
+        decode(values);
+        ctm::vector<value_type> words((size_ * new_width + 63) / 64 + 1, value_type(0));
+
+        words_.swap(words);
+        width_ = new_width;
+
+        for (size_type i = 0; i < size_; ++i)
+        {
+            write_packed(i, values[i]);
+        }
+    }
+
+    // Computes the stored (base-relative) value for index i of values.
+    value_type stored_value(const ctm::vector<value_type>& values, size_type i) const
+    {
+        switch (mode_)
+        {
+            case ctm::packing::frame_of_reference:
+                return values[i] - bases_[i / block_size];
+            case ctm::packing::delta:
+                return (i % block_size == 0) ? 0 : values[i] - values[i - 1];
+            default:
+                return values[i];
+        }
+    }
+
+    void build(const ctm::vector<value_type>& values)
+    {
+        size_ = values.size();
+
+        if (mode_ != ctm::packing::plain)
+        {
+            bases_.reserve((size_ + block_size - 1) / block_size);
+
+            for (size_type begin = 0; begin < size_; begin += block_size)
+            {
+                const size_type end = std::min(begin + block_size, size_);
+
+                if (mode_ == ctm::packing::delta)
+                {
+                    for (size_type i = begin + 1; i < end; ++i)
+                    {
+                        if (values[i] < values[i - 1])
+                        {
+                            throw std::invalid_argument("Delta packing requires non-decreasing values");
+                        }
+                    }
+                    bases_.push_back(values[begin]);
+                }
+                else
+                {
+                    bases_.push_back(*std::min_element(values.begin() + begin, values.begin() + end));
+                }
+            }
+        }
+
+        value_type max_stored = 0;
+
+        for (size_type i = 0; i < size_; ++i)
+        {
+            max_stored = std::max(max_stored, stored_value(values, i));
+        }
+
+        const unsigned needed = std::max(1u, static_cast<unsigned>(std::bit_width(max_stored)));
+
+        if constexpr (Width != 0)
+        {
+            if (needed > Width)
+            {
+                throw std::out_of_range("Value does not fit the packed bit width");
+            }
+        }
+        else
+        {
+            width_ = needed;
+        }
+
+        words_.resize(words_for(size_), 0);
+
+        for (size_type i = 0; i < size_; ++i)
+        {
+            write_packed(i, stored_value(values, i));
+        }
+    }
+
+    template <typename U>
+    void decode_into(ctm::vector<U>& out) const
+    {
+        out.clear();
+        out.resize(size_);
+        U* dst = out.data();
+        size_type i = 0;
+
+#if defined(__AVX2__)
+        if constexpr (sizeof(U) == sizeof(std::uint32_t))
+        {
+            if (width() <= 32)
+            {
+                i = unpack_avx2(dst);
+            }
+        }
+#endif
+
+        for (; i < size_; ++i)
+        {
+            dst[i] = static_cast<U>(read_packed(i));
+        }
+
+        if (mode_ == ctm::packing::plain)
+        {
+            return;
+        }
+
+        for (size_type begin = 0; begin < size_; begin += block_size)
+        {
+            const size_type end = std::min(begin + block_size, size_);
+            U running = static_cast<U>(bases_[begin / block_size]);
+
+            if (mode_ == ctm::packing::frame_of_reference)
+            {
+                for (size_type j = begin; j < end; ++j)
+                {
+                    dst[j] += running;
+                }
+            }
+            else
+            {
+                for (size_type j = begin; j < end; ++j)
+                {
+                    running += dst[j];
+                    dst[j] = running;
+                }
+            }
+        }
+    }
+
+#if defined(__AVX2__)
+    // Gathers the two words holding each of four values, funnel-shifts them
+    // with variable shifts and narrows the result to 32 bits. Returns the
+    // number of values written.
+    size_type unpack_avx2(std::uint32_t* dst) const
+    {
+        const long long w = width();
+        const __m256i lane_bits = _mm256_setr_epi64x(0, w, 2 * w, 3 * w);
+        const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(this->mask()));
+        const __m256i sixty_four = _mm256_set1_epi64x(64);
+        const __m256i narrow = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+        const long long* words = reinterpret_cast<const long long*>(words_.data());
+        size_type i = 0;
+
+        for (; i + 4 <= size_; i += 4)
+        {
+            const __m256i bits = _mm256_add_epi64(_mm256_set1_epi64x(static_cast<long long>(i * w)), lane_bits);
+            const __m256i index = _mm256_srli_epi64(bits, 6);
+            const __m256i shift = _mm256_and_si256(bits, _mm256_set1_epi64x(63));
+            const __m256i lo = _mm256_i64gather_epi64(words, index, 8);
+            const __m256i hi = _mm256_i64gather_epi64(words + 1, index, 8);
+            // sllv yields zero for a count of 64, covering shift == 0
+            const __m256i value = _mm256_and_si256(
+                _mm256_or_si256(_mm256_srlv_epi64(lo, shift),
+                                _mm256_sllv_epi64(hi, _mm256_sub_epi64(sixty_four, shift))),
+                mask);
+            const __m256i packed = _mm256_permutevar8x32_epi32(value, narrow);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_castsi256_si128(packed));
+        }
+        return i;
+    }
+#endif
+};
+
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "custom_allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace ctm
+{
+
+// Tags for vector::reserve(n, tag). prefault populates the new pages before
+// returning; prefault_async does so on a background thread.
+struct prefault_t
+{
+    explicit prefault_t() = default;
+};
+
+struct prefault_async_t
+{
+    explicit prefault_async_t() = default;
+};
+
+inline constexpr prefault_t prefault{};
+inline constexpr prefault_async_t prefault_async{};
+
+namespace detail
+{
+
+#if defined(__linux__)
+// MADV_POPULATE_WRITE (Linux 5.14) may be missing from older headers.
+inline constexpr int madv_populate_write =
+#if defined(MADV_POPULATE_WRITE)
+    MADV_POPULATE_WRITE;
+#else
+    23;
+#endif
+
+inline std::size_t page_size()
+{
+    static const std::size_t size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+// Asks the kernel to populate the pages wholly inside [p, p + bytes) as if
+// written. Returns false if the kernel cannot, e.g. before Linux 5.14.
+inline bool populate_write(void* p, std::size_t bytes)
+{
+    const std::uintptr_t page = page_size();
+    const std::uintptr_t first = (reinterpret_cast<std::uintptr_t>(p) + page - 1) & ~(page - 1);
+    const std::uintptr_t last = (reinterpret_cast<std::uintptr_t>(p) + bytes) & ~(page - 1);
+
+    if (last <= first)
+    {
+        return true;
+    }
+    return madvise(reinterpret_cast<void*>(first), last - first, madv_populate_write) == 0;
+}
+#endif
+
+// Faults in the pages backing raw storage [p, p + bytes). Falls back to
+// writing one byte per page; the storage must not hold live objects.
+inline void prefault_pages(void* p, std::size_t bytes)
+{
+#if defined(__linux__)
+    if (bytes == 0 || populate_write(p, bytes))
+    {
+        return;
+    }
+
+    volatile unsigned char* bytes_ptr = static_cast<unsigned char*>(p);
+
+    for (std::size_t offset = 0; offset < bytes; offset += page_size())
+    {
+        bytes_ptr[offset] = 0;
+    }
+
+    bytes_ptr[bytes - 1] = 0;
+#else
+    (void)p;
+    (void)bytes;
+#endif
+}
+
+// Background variant: only the kernel populates the pages, nothing is
+// written, so the owner may use the storage while this runs. Best effort.
+inline std::future<void> prefault_pages_async(void* p, std::size_t bytes)
+{
+    return std::async(std::launch::async, [p, bytes]()
+    {
+#if defined(__linux__)
+        populate_write(p, bytes);
+#else
+        (void)p;
+        (void)bytes;
+#endif
+    });
+}
+
+};
+
+// Allocator adaptor whose every allocation is prefaulted before it is
+// returned, so no container built on it takes first-touch page faults.
+template <typename T, typename Base = ctm::allocator<T>>
+class prefaulting_allocator : public Base
+{
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = prefaulting_allocator<U,
+            typename std::allocator_traits<Base>::template rebind_alloc<U>>;
+    };
+
+    constexpr prefaulting_allocator() noexcept = default;
+
+    constexpr prefaulting_allocator(const Base& base) noexcept:
+        Base(base) {}
+
+    template <typename U, typename OtherBase>
+    constexpr prefaulting_allocator(const prefaulting_allocator<U, OtherBase>& other) noexcept:
+        Base(static_cast<const OtherBase&>(other)) {}
+
+    constexpr T* allocate(std::size_t n)
+    {
+        T* p = std::allocator_traits<Base>::allocate(static_cast<Base&>(*this), n);
+
+        if (!std::is_constant_evaluated())
+        {
+            detail::prefault_pages(p, n * sizeof(T));
+        }
+        return p;
+    }
+};
+
+};
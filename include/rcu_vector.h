@@ -0,0 +1,326 @@
+#pragma once
+
+#include "custom_vector.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <utility>
+
+namespace ctm
+{
+
+// Read-mostly vector. Readers take a snapshot of an immutable buffer with a
+// fixed number of atomic operations and no locks; writers copy the current
+// buffer, modify the copy and publish it with one atomic pointer swap.
+//
+// Replaced buffers are reclaimed with epoch-based reclamation. A reader
+// announces itself in the counter for the parity of the current epoch
+// before loading the pointer. The epoch only advances past e + 1 once no
+// reader is counted under e's parity, so a buffer retired in epoch e is
+// freed once the epoch reaches e + 2: every reader that could still see it
+// has left by then. Reclamation is deferred, never waited for; writers
+// retry it after each publish.
+template <typename T, typename Allocator = ctm::allocator<T>>
+class rcu_vector
+{
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using allocator_type = Allocator;
+    using vector_type = ctm::vector<T, Allocator>;
+
+    // A pinned, immutable view of the vector at the time it was taken. Keep
+    // it short-lived: while it exists, buffers retired after it cannot be
+    // freed.
+    class snapshot
+    {
+    public:
+        snapshot(snapshot&& other) noexcept:
+            values_(std::exchange(other.values_, nullptr)),
+            counter_(std::exchange(other.counter_, nullptr)) {}
+
+        snapshot(const snapshot&) = delete;
+        snapshot& operator=(const snapshot&) = delete;
+        snapshot& operator=(snapshot&&) = delete;
+
+        ~snapshot()
+        {
+            if (counter_)
+            {
+                counter_->fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        const vector_type& operator*() const
+        {
+            return *values_;
+        }
+
+        const vector_type* operator->() const
+        {
+            return values_;
+        }
+
+        const T& operator[](size_type index) const
+        {
+            return (*values_)[index];
+        }
+
+        size_type size() const
+        {
+            return values_->size();
+        }
+
+        bool empty() const
+        {
+            return values_->empty();
+        }
+
+        auto begin() const
+        {
+            return values_->begin();
+        }
+
+        auto end() const
+        {
+            return values_->end();
+        }
+
+    private:
+        friend class rcu_vector;
+
+        const vector_type* values_;
+        std::atomic<std::uint64_t>* counter_;
+
+        snapshot(const vector_type* values, std::atomic<std::uint64_t>* counter):
+            values_(values),
+            counter_(counter) {}
+    };
+
+    // Collects any number of changes to a private copy under the writer
+    // lock and publishes them together, once. A batch destroyed without
+    // commit() is discarded, so a writer that throws publishes nothing.
+    class write_batch
+    {
+    public:
+        write_batch(write_batch&& other) noexcept:
+            owner_(std::exchange(other.owner_, nullptr)),
+            lock_(std::move(other.lock_)),
+            draft_(std::exchange(other.draft_, nullptr)) {}
+
+        write_batch(const write_batch&) = delete;
+        write_batch& operator=(const write_batch&) = delete;
+        write_batch& operator=(write_batch&&) = delete;
+
+        ~write_batch()
+        {
+            delete draft_;
+        }
+
+        vector_type& operator*()
+        {
+            return *draft_;
+        }
+
+        vector_type* operator->()
+        {
+            return draft_;
+        }
+
+        // Publishes the changes and releases the writer lock.
+        void commit()
+        {
+            owner_->publish(draft_);
+            draft_ = nullptr;
+            lock_.unlock();
+        }
+
+    private:
+        friend class rcu_vector;
+
+        rcu_vector* owner_;
+        std::unique_lock<std::mutex> lock_;
+        vector_type* draft_;
+
+        explicit write_batch(rcu_vector* owner):
+            owner_(owner),
+            lock_(owner->writer_mutex_),
+            draft_(new vector_type(*owner->current_.load(std::memory_order_relaxed))) {}
+    };
+
+    rcu_vector():
+        rcu_vector(vector_type()) {}
+
+    explicit rcu_vector(const vector_type& values):
+        current_(new vector_type(values)),
+        epoch_(0),
+        version_(0) {}
+
+    rcu_vector(std::initializer_list<T> init):
+        rcu_vector(vector_type(init)) {}
+
+    rcu_vector(const rcu_vector&) = delete;
+    rcu_vector& operator=(const rcu_vector&) = delete;
+
+    // No snapshot may outlive the vector.
+    ~rcu_vector()
+    {
+        for (retired& old : retired_)
+        {
+            delete old.values;
+        }
+        delete current_.load(std::memory_order_relaxed);
+    }
+
+    // READERS
+    snapshot read() const
+    {
+        const std::uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+        std::atomic<std::uint64_t>* counter = &stripes_[stripe_index()].active[epoch & 1];
+        counter->fetch_add(1, std::memory_order_seq_cst);
+        return snapshot(current_.load(std::memory_order_seq_cst), counter);
+    }
+
+    // Number of buffers published so far.
+    std::uint64_t version() const
+    {
+        return version_.load(std::memory_order_acquire);
+    }
+
+    // WRITERS
+    // Copies the current contents, applies fn to the copy and publishes it.
+    // Every change fn makes costs a single publish.
+    template <typename Fn>
+    void update(Fn fn)
+    {
+        write_batch batch = write();
+        fn(*batch);
+        batch.commit();
+    }
+
+    write_batch write()
+    {
+        return write_batch(this);
+    }
+
+    void assign(const vector_type& values)
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        publish(new vector_type(values));
+    }
+
+    void push_back(const T& value)
+    {
+        update([&value](vector_type& values) { values.push_back(value); });
+    }
+
+    void set(size_type index, const T& value)
+    {
+        update([index, &value](vector_type& values) { values.at(index) = value; });
+    }
+
+    // RECLAMATION
+    // Frees the retired buffers no reader can still see and returns how
+    // many were freed.
+    size_type reclaim()
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        return reclaim_locked();
+    }
+
+    // Retired buffers still waiting for readers to leave.
+    size_type retired_count() const
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        return retired_.size();
+    }
+
+private:
+    struct alignas(64) stripe
+    {
+        std::array<std::atomic<std::uint64_t>, 2> active{};
+    };
+
+    struct retired
+    {
+        vector_type* values;
+        std::uint64_t epoch;
+    };
+
+    // readers spread over stripes so they do not share one cache line
+    static constexpr size_type stripe_count = 16;
+
+    std::atomic<vector_type*> current_;
+    std::atomic<std::uint64_t> epoch_;
+    std::atomic<std::uint64_t> version_;
+    mutable std::array<stripe, stripe_count> stripes_;
+    mutable std::mutex writer_mutex_;
+    ctm::vector<retired> retired_;
+
+    static size_type stripe_index()
+    {
+        static std::atomic<size_type> next_thread{0};
+        static thread_local const size_type index = next_thread.fetch_add(1, std::memory_order_relaxed) % stripe_count;
+        return index;
+    }
+
+    // Requires the writer lock.
+    void publish(vector_type* values)
+    {
+        vector_type* old = current_.exchange(values, std::memory_order_seq_cst);
+        version_.fetch_add(1, std::memory_order_release);
+        retired_.push_back(retired{old, epoch_.load(std::memory_order_relaxed)});
+        reclaim_locked();
+    }
+
+    // Advances the epoch while no reader is counted under the parity of the
+    // epoch before the current one.
+    bool try_advance()
+    {
+        const std::uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+        const size_type parity = (epoch + 1) & 1;
+
+        for (const stripe& s : stripes_)
+        {
+            if (s.active[parity].load(std::memory_order_seq_cst) != 0)
+            {
+                return false;
+            }
+        }
+
+        epoch_.store(epoch + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    size_type reclaim_locked()
+    {
+        if (retired_.empty())
+        {
+            return 0;
+        }
+
+        // two advances are enough for everything retired so far
+        const std::uint64_t target = retired_.back().epoch + 2;
+
+        while (epoch_.load(std::memory_order_relaxed) < target && try_advance())
+        {
+        }
+
+        const std::uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+        size_type freed = 0;
+
+        while (freed < retired_.size() && retired_[freed].epoch + 2 <= epoch)
+        {
+            delete retired_[freed].values;
+            ++freed;
+        }
+
+        retired_.erase(retired_.begin(), retired_.begin() + freed);
+        return freed;
+    }
+};
+
+};
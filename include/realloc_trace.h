@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ctm
+{
+
+// One buffer reallocation inside ctm::vector::reserve(), reported when the
+// library is built with CTM_VECTOR_TRACING.
+struct realloc_event
+{
+    const void* container;
+    const char* tag;            // set with vector::set_trace_tag(), may be null
+    std::size_t old_capacity;
+    std::size_t new_capacity;
+    std::size_t elements_moved;
+    std::size_t bytes_copied;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::nanoseconds duration;
+};
+
+using realloc_observer = void (*)(const realloc_event& event, void* context);
+
+namespace detail
+{
+
+struct realloc_observer_slot
+{
+    std::atomic<realloc_observer> observer{nullptr};
+    std::atomic<void*> context{nullptr};
+
+    static realloc_observer_slot& instance()
+    {
+        static realloc_observer_slot slot;
+        return slot;
+    }
+};
+
+// Set while an observer runs so that reallocations made by the observer
+// itself are not reported back to it.
+inline thread_local bool in_realloc_observer = false;
+
+inline bool realloc_tracing_active()
+{
+    return realloc_observer_slot::instance().observer.load(std::memory_order_acquire) != nullptr &&
+           !in_realloc_observer;
+}
+
+inline void report_realloc(const realloc_event& event)
+{
+    realloc_observer_slot& slot = realloc_observer_slot::instance();
+    const realloc_observer observer = slot.observer.load(std::memory_order_acquire);
+
+    if (observer == nullptr || in_realloc_observer)
+    {
+        return;
+    }
+
+    in_realloc_observer = true;
+    observer(event, slot.context.load(std::memory_order_acquire));
+    in_realloc_observer = false;
+}
+
+};
+
+// Installs a process-wide observer; pass nullptr to remove it. The observer
+// may be called concurrently from every thread that grows a vector, so
+// replace or remove it only while no traced vector is being reallocated.
+inline void set_realloc_observer(realloc_observer observer, void* context = nullptr)
+{
+    detail::realloc_observer_slot& slot = detail::realloc_observer_slot::instance();
+    slot.observer.store(nullptr, std::memory_order_release);
+    slot.context.store(context, std::memory_order_release);
+    slot.observer.store(observer, std::memory_order_release);
+}
+
+// Records every reallocation while alive and writes them as Chrome trace
+// event JSON, loadable in chrome://tracing and ui.perfetto.dev.
+class chrome_trace_recorder
+{
+public:
+    chrome_trace_recorder():
+        origin_(std::chrono::steady_clock::now())
+    {
+        set_realloc_observer(&chrome_trace_recorder::record, this);
+    }
+
+    chrome_trace_recorder(const chrome_trace_recorder&) = delete;
+    chrome_trace_recorder& operator=(const chrome_trace_recorder&) = delete;
+
+    ~chrome_trace_recorder()
+    {
+        set_realloc_observer(nullptr);
+    }
+
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return events_.size();
+    }
+
+    void write(std::ostream& os) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        os << "{\"traceEvents\":[";
+
+        for (std::size_t i = 0; i < events_.size(); ++i)
+        {
+            const recorded_event& e = events_[i];
+            os << (i == 0 ? "" : ",") << "\n"
+               << "{\"name\":\"";
+            write_escaped(os, e.tag.empty() ? "reallocate" : e.tag);
+            os << "\""
+               << ",\"cat\":\"ctm.vector\",\"ph\":\"X\",\"pid\":1"
+               << ",\"tid\":" << e.thread
+               << ",\"ts\":" << e.start_us
+               << ",\"dur\":" << e.duration_us
+               << ",\"args\":{\"container\":\"" << e.container << "\""
+               << ",\"old_capacity\":" << e.old_capacity
+               << ",\"new_capacity\":" << e.new_capacity
+               << ",\"elements_moved\":" << e.elements_moved
+               << ",\"bytes_copied\":" << e.bytes_copied << "}}";
+        }
+        os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    }
+
+    void write_file(const std::string& path) const
+    {
+        std::ofstream file(path);
+
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open trace file " + path);
+        }
+        write(file);
+    }
+
+private:
+    struct recorded_event
+    {
+        std::string tag;
+        const void* container;
+        std::size_t old_capacity;
+        std::size_t new_capacity;
+        std::size_t elements_moved;
+        std::size_t bytes_copied;
+        std::size_t thread;
+        double start_us;
+        double duration_us;
+    };
+
+    std::chrono::steady_clock::time_point origin_;
+    mutable std::mutex mutex_;
+    std::vector<recorded_event> events_;
+
+    static void write_escaped(std::ostream& os, const std::string& text)
+    {
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                os << '\\';
+            }
+            os << c;
+        }
+    }
+
+    static void record(const realloc_event& event, void* context)
+    {
+        chrome_trace_recorder* self = static_cast<chrome_trace_recorder*>(context);
+        using micros = std::chrono::duration<double, std::micro>;
+
+        recorded_event e{
+            event.tag ? event.tag : "",
+            event.container,
+            event.old_capacity,
+            event.new_capacity,
+            event.elements_moved,
+            event.bytes_copied,
+            std::hash<std::thread::id>()(std::this_thread::get_id()),
+            micros(event.start - self->origin_).count(),
+            micros(event.duration).count()};
+
+        std::lock_guard<std::mutex> lock(self->mutex_);
+        self->events_.push_back(std::move(e));
+    }
+};
+
+};
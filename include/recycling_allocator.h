@@ -0,0 +1,392 @@
+#pragma once
+
+#include "custom_vector.h"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace ctm
+{
+
+namespace detail
+{
+
+// Buffers are handed out in power-of-two byte classes so that any freed
+// buffer of a class can serve any later request of the same class.
+inline constexpr std::size_t recycler_classes = 48;
+inline constexpr std::size_t recycler_thread_slots = 4;
+
+inline std::size_t recycler_class(std::size_t bytes)
+{
+    return bytes <= 1 ? 0 : static_cast<std::size_t>(std::bit_width(bytes - 1));
+}
+
+inline std::size_t recycler_class_bytes(std::size_t cls)
+{
+    return std::size_t(1) << cls;
+}
+
+inline void recycler_free(void* p, [[maybe_unused]] std::size_t cls)
+{
+#if defined(CTM_ALLOCATOR_STATS)
+    ctm::detail::record_deallocation(recycler_class_bytes(cls));
+#endif
+    ::operator delete(p);
+}
+
+struct recycler_limits
+{
+    std::atomic<std::size_t> thread_bytes{16 * 1024 * 1024};
+    std::atomic<std::size_t> global_bytes{256 * 1024 * 1024};
+
+    static recycler_limits& instance()
+    {
+        static recycler_limits limits;
+        return limits;
+    }
+};
+
+// Shared tier, used when a thread's own cache is full or empty. Never
+// destroyed, so vectors with static storage can still return their buffers
+// during exit.
+class global_recycler
+{
+public:
+    static global_recycler& instance()
+    {
+        static global_recycler* recycler = new global_recycler();
+        return *recycler;
+    }
+
+    void* take(std::size_t cls)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (free_[cls].empty())
+        {
+            return nullptr;
+        }
+
+        void* p = free_[cls].back();
+        free_[cls].pop_back();
+        bytes_ -= recycler_class_bytes(cls);
+        return p;
+    }
+
+    bool give(std::size_t cls, void* p)
+    {
+        const std::size_t size = recycler_class_bytes(cls);
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (bytes_ + size > recycler_limits::instance().global_bytes.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        // reached from noexcept deallocate: if the list cannot grow, the
+        // caller frees the block instead
+        try
+        {
+            free_[cls].push_back(p);
+        }
+        catch (const std::bad_alloc&)
+        {
+            return false;
+        }
+
+        bytes_ += size;
+        return true;
+    }
+
+    std::size_t cached_bytes()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytes_;
+    }
+
+    std::size_t release_all()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const std::size_t released = bytes_;
+
+        for (std::size_t cls = 0; cls < recycler_classes; ++cls)
+        {
+            for (void* p : free_[cls])
+            {
+                recycler_free(p, cls);
+            }
+            free_[cls].clear();
+        }
+
+        bytes_ = 0;
+        return released;
+    }
+
+private:
+    std::mutex mutex_;
+    std::array<std::vector<void*>, recycler_classes> free_;
+    std::size_t bytes_ = 0;
+};
+
+// Per-thread tier: a few buffers per class, no locking.
+struct thread_recycler
+{
+    std::array<std::array<void*, recycler_thread_slots>, recycler_classes> free{};
+    std::array<std::size_t, recycler_classes> count{};
+    std::size_t bytes = 0;
+
+    void* take(std::size_t cls)
+    {
+        if (count[cls] == 0)
+        {
+            return nullptr;
+        }
+
+        bytes -= recycler_class_bytes(cls);
+        return free[cls][--count[cls]];
+    }
+
+    bool give(std::size_t cls, void* p)
+    {
+        const std::size_t size = recycler_class_bytes(cls);
+
+        if (count[cls] == recycler_thread_slots ||
+            bytes + size > recycler_limits::instance().thread_bytes.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        free[cls][count[cls]++] = p;
+        bytes += size;
+        return true;
+    }
+
+    // Hands cached buffers to the global tier, or frees them all when
+    // to_global is false. Returns the number of bytes freed.
+    std::size_t flush(bool to_global = true)
+    {
+        std::size_t released = 0;
+
+        for (std::size_t cls = 0; cls < recycler_classes; ++cls)
+        {
+            while (count[cls] > 0)
+            {
+                void* p = free[cls][--count[cls]];
+
+                if (!to_global || !global_recycler::instance().give(cls, p))
+                {
+                    recycler_free(p, cls);
+                    released += recycler_class_bytes(cls);
+                }
+            }
+        }
+
+        bytes = 0;
+        return released;
+    }
+};
+
+// Plain thread_locals so that buffers freed during static destruction, after
+// the guard below has flushed the cache, go straight to the global tier.
+inline thread_local thread_recycler* local_recycler = nullptr;
+inline thread_local bool local_recycler_flushed = false;
+
+struct thread_recycler_guard
+{
+    thread_recycler cache;
+
+    ~thread_recycler_guard()
+    {
+        cache.flush();
+        local_recycler = nullptr;
+        local_recycler_flushed = true;
+    }
+};
+
+inline thread_recycler* thread_cache()
+{
+    if (local_recycler == nullptr && !local_recycler_flushed)
+    {
+        thread_local thread_recycler_guard guard;
+        local_recycler = &guard.cache;
+    }
+    return local_recycler;
+}
+
+inline void* recycler_allocate(std::size_t bytes)
+{
+    const std::size_t cls = recycler_class(bytes);
+    thread_recycler* cache = thread_cache();
+    void* p = cache ? cache->take(cls) : nullptr;
+
+    if (p == nullptr)
+    {
+        p = global_recycler::instance().take(cls);
+    }
+
+    if (p == nullptr)
+    {
+        p = ::operator new(recycler_class_bytes(cls));
+#if defined(CTM_ALLOCATOR_STATS)
+        ctm::detail::record_allocation(recycler_class_bytes(cls));
+#endif
+    }
+    return p;
+}
+
+inline void recycler_deallocate(void* p, std::size_t bytes)
+{
+    const std::size_t cls = recycler_class(bytes);
+    thread_recycler* cache = thread_cache();
+
+    if ((cache && cache->give(cls, p)) || global_recycler::instance().give(cls, p))
+    {
+        return;
+    }
+    recycler_free(p, cls);
+}
+
+};
+
+// Controls for the buffer cache shared by every recycling_allocator.
+struct buffer_recycler
+{
+    // Byte caps for each thread's private cache and for the shared cache.
+    static void set_limits(std::size_t thread_bytes, std::size_t global_bytes)
+    {
+        detail::recycler_limits::instance().thread_bytes.store(thread_bytes, std::memory_order_relaxed);
+        detail::recycler_limits::instance().global_bytes.store(global_bytes, std::memory_order_relaxed);
+    }
+
+    static std::size_t thread_cached_bytes()
+    {
+        detail::thread_recycler* cache = detail::thread_cache();
+        return cache ? cache->bytes : 0;
+    }
+
+    static std::size_t global_cached_bytes()
+    {
+        return detail::global_recycler::instance().cached_bytes();
+    }
+
+    // Moves the calling thread's cache to the shared tier; buffers beyond the
+    // shared cap are freed.
+    static void flush_thread_cache()
+    {
+        detail::thread_recycler* cache = detail::thread_cache();
+
+        if (cache)
+        {
+            cache->flush();
+        }
+    }
+
+    // Frees the calling thread's cache and the shared cache. Returns the
+    // number of bytes given back to the heap.
+    static std::size_t release()
+    {
+        detail::thread_recycler* cache = detail::thread_cache();
+        const std::size_t released = cache ? cache->flush(false) : 0;
+        return released + detail::global_recycler::instance().release_all();
+    }
+};
+
+// Allocator that recycles freed buffers instead of returning them to the
+// heap. A vector that is destroyed, or that outgrows its buffer, leaves the
+// buffer in a cache keyed by power-of-two size class; the next allocation of
+// that class on any thread reuses it, already faulted in and warm. Requests
+// are rounded up to their class size.
+template <typename T>
+class recycling_allocator
+{
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                  "recycling_allocator only serves default-aligned types");
+
+    constexpr recycling_allocator() noexcept = default;
+
+    constexpr recycling_allocator(const recycling_allocator& other) noexcept = default;
+
+    template <typename U>
+    constexpr recycling_allocator(const recycling_allocator<U>& other) noexcept {};
+
+    constexpr T* allocate(const std::size_t n)
+    {
+        if (n == 0)
+        {
+            return nullptr;
+        }
+
+        if (n > max_size())
+        {
+            throw std::bad_alloc();
+        }
+
+        if (std::is_constant_evaluated())
+        {
+            return std::allocator<T>().allocate(n);
+        }
+
+        return static_cast<T*>(detail::recycler_allocate(n * sizeof(T)));
+    }
+
+    constexpr void deallocate(T* p, const std::size_t n) noexcept
+    {
+        if (std::is_constant_evaluated())
+        {
+            std::allocator<T>().deallocate(p, n);
+            return;
+        }
+
+        if (p)
+        {
+            detail::recycler_deallocate(p, n * sizeof(T));
+        }
+    }
+
+    template <typename U, typename... Args>
+    constexpr void construct(U* p, Args&&... args)
+    {
+        std::construct_at(p, std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    constexpr void destroy(U* p) noexcept
+    {
+        p->~U();
+    }
+
+    template <typename U>
+    struct rebind
+    {
+        using other = recycling_allocator<U>;
+    };
+
+    constexpr std::size_t max_size() const noexcept
+    {
+        return (std::size_t(1) << (detail::recycler_classes - 1)) / sizeof(T);
+    }
+
+    constexpr bool operator==(const recycling_allocator&) const noexcept
+    {
+        return true;
+    }
+
+    constexpr bool operator!=(const recycling_allocator&) const noexcept
+    {
+        return false;
+    }
+};
+
+template <typename T>
+using recycling_vector = ctm::vector<T, recycling_allocator<T>>;
+
+};
@@ -0,0 +1,519 @@
+#pragma once
+
+#include "custom_allocator.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace ctm
+{
+
+// Growable circular buffer. Capacity is always a power of two so logical
+// index i maps to slot (head + i) & (capacity - 1); pushing and popping at
+// either end is O(1) and never shifts elements.
+template <typename T, typename Allocator = ctm::allocator<T>>
+class ring_vector
+{
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using allocator_type = Allocator;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+
+    template <bool Const>
+    class basic_iterator
+    {
+    public:
+        using ring_pointer = std::conditional_t<Const, const ring_vector*, ring_vector*>;
+        using value_type = T;
+        using reference = std::conditional_t<Const, const T&, T&>;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::random_access_iterator_tag;
+
+        basic_iterator():
+            ring_(nullptr),
+            index_(0) {}
+
+        basic_iterator(ring_pointer ring, size_type index):
+            ring_(ring),
+            index_(index) {}
+
+        // iterator converts to const_iterator
+        template <bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+        basic_iterator(const basic_iterator<OtherConst>& other):
+            ring_(other.ring_),
+            index_(other.index_) {}
+
+        reference operator*() const
+        {
+            return (*ring_)[index_];
+        }
+
+        pointer operator->() const
+        {
+            return &(*ring_)[index_];
+        }
+
+        reference operator[](difference_type n) const
+        {
+            return *(*this + n);
+        }
+
+        basic_iterator& operator++()
+        {
+            ++index_;
+            return *this;
+        }
+
+        basic_iterator operator++(int)
+        {
+            basic_iterator old = *this;
+            ++index_;
+            return old;
+        }
+
+        basic_iterator& operator--()
+        {
+            --index_;
+            return *this;
+        }
+
+        basic_iterator operator--(int)
+        {
+            basic_iterator old = *this;
+            --index_;
+            return old;
+        }
+
+        basic_iterator& operator+=(difference_type n)
+        {
+            index_ = static_cast<size_type>(static_cast<difference_type>(index_) + n);
+            return *this;
+        }
+
+        basic_iterator& operator-=(difference_type n)
+        {
+            return *this += -n;
+        }
+
+        friend basic_iterator operator+(basic_iterator it, difference_type n)
+        {
+            return it += n;
+        }
+
+        friend basic_iterator operator+(difference_type n, basic_iterator it)
+        {
+            return it += n;
+        }
+
+        friend basic_iterator operator-(basic_iterator it, difference_type n)
+        {
+            return it -= n;
+        }
+
+        friend difference_type operator-(const basic_iterator& a, const basic_iterator& b)
+        {
+            return static_cast<difference_type>(a.index_) - static_cast<difference_type>(b.index_);
+        }
+
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b)
+        {
+            return a.index_ == b.index_;
+        }
+
+        friend auto operator<=>(const basic_iterator& a, const basic_iterator& b)
+        {
+            return a.index_ <=> b.index_;
+        }
+
+    private:
+        template <bool>
+        friend class basic_iterator;
+
+        ring_pointer ring_;
+        size_type index_;
+    };
+
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    ring_vector():
+        ring_vector(Allocator()) {}
+
+    explicit ring_vector(const Allocator& alloc):
+        data_(nullptr),
+        head_(0),
+        size_(0),
+        capacity_(0),
+        allocator_(alloc) {}
+
+    template <typename InputIt,
+              typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+    ring_vector(InputIt first, InputIt last, const Allocator& alloc = Allocator()):
+        ring_vector(alloc)
+    {
+        for (; first != last; ++first)
+        {
+            push_back(*first);
+        }
+    }
+
+    ring_vector(std::initializer_list<T> init, const Allocator& alloc = Allocator()):
+        ring_vector(init.begin(), init.end(), alloc) {}
+
+    ring_vector(const ring_vector& other):
+        ring_vector(alloc_traits::select_on_container_copy_construction(other.allocator_))
+    {
+        reserve(other.size_);
+
+        for (const T& value : other)
+        {
+            push_back(value);
+        }
+    }
+
+    ring_vector(ring_vector&& other) noexcept:
+        data_(std::exchange(other.data_, nullptr)),
+        head_(std::exchange(other.head_, 0)),
+        size_(std::exchange(other.size_, 0)),
+        capacity_(std::exchange(other.capacity_, 0)),
+        allocator_(other.allocator_) {}
+
+    ring_vector& operator=(const ring_vector& other)
+    {
+        if (this != &other)
+        {
+            ring_vector copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    ring_vector& operator=(ring_vector&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release_memory();
+            swap(other);
+        }
+        return *this;
+    }
+
+    ~ring_vector()
+    {
+        release_memory();
+    }
+
+    // ELEMENT ACCESS
+    reference at(size_type index)
+    {
+        if (index >= size_)
+        {
+            throw std::out_of_range("Indexing out of range");
+        }
+        return (*this)[index];
+    }
+
+    const_reference at(size_type index) const
+    {
+        if (index >= size_)
+        {
+            throw std::out_of_range("Indexing out of range");
+        }
+        return (*this)[index];
+    }
+
+    reference operator[](size_type index)
+    {
+        return data_[slot(index)];
+    }
+
+    const_reference operator[](size_type index) const
+    {
+        return data_[slot(index)];
+    }
+
+    reference front()
+    {
+        return data_[head_];
+    }
+
+    const_reference front() const
+    {
+        return data_[head_];
+    }
+
+    reference back()
+    {
+        return data_[slot(size_ - 1)];
+    }
+
+    const_reference back() const
+    {
+        return data_[slot(size_ - 1)];
+    }
+
+    // The elements in order as at most two contiguous segments; the second
+    // is empty unless the contents wrap around the end of the buffer.
+    std::pair<std::span<T>, std::span<T>> as_spans()
+    {
+        const size_type first = std::min(size_, capacity_ - head_);
+        return {std::span<T>(data_ + head_, first), std::span<T>(data_, size_ - first)};
+    }
+
+    std::pair<std::span<const T>, std::span<const T>> as_spans() const
+    {
+        const size_type first = std::min(size_, capacity_ - head_);
+        return {std::span<const T>(data_ + head_, first), std::span<const T>(data_, size_ - first)};
+    }
+
+    // ITERATORS
+    iterator begin()
+    {
+        return iterator(this, 0);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator cbegin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    iterator end()
+    {
+        return iterator(this, size_);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, size_);
+    }
+
+    const_iterator cend() const
+    {
+        return const_iterator(this, size_);
+    }
+
+    // CAPACITY
+    bool empty() const
+    {
+        return (size_ == 0);
+    }
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+    size_type capacity() const
+    {
+        return capacity_;
+    }
+
+    // Rounds new_capacity up to a power of two.
+    void reserve(size_type new_capacity)
+    {
+        if (new_capacity > capacity_)
+        {
+            reallocate(std::bit_ceil(new_capacity));
+        }
+    }
+
+    // Destroys every element and frees the buffer.
+    void release_memory()
+    {
+        clear();
+
+        if (data_)
+        {
+            alloc_traits::deallocate(allocator_, data_, capacity_);
+        }
+
+        data_ = nullptr;
+        capacity_ = 0;
+    }
+
+    // MODIFIERS
+    void clear()
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            for (size_type i = 0; i < size_; ++i)
+            {
+                alloc_traits::destroy(allocator_, data_ + slot(i));
+            }
+        }
+
+        head_ = 0;
+        size_ = 0;
+    }
+
+    void push_back(const T& value)
+    {
+        emplace_back(value);
+    }
+
+    void push_back(T&& value)
+    {
+        emplace_back(std::move(value));
+    }
+
+    template <typename... Args>
+    reference emplace_back(Args&&... args)
+    {
+        if (size_ == capacity_)
+        {
+            T value(std::forward<Args>(args)...);
+            grow();
+            alloc_traits::construct(allocator_, data_ + slot(size_), std::move(value));
+        }
+        else
+        {
+            alloc_traits::construct(allocator_, data_ + slot(size_), std::forward<Args>(args)...);
+        }
+
+        ++size_;
+        return back();
+    }
+
+    void push_front(const T& value)
+    {
+        emplace_front(value);
+    }
+
+    void push_front(T&& value)
+    {
+        emplace_front(std::move(value));
+    }
+
+    template <typename... Args>
+    reference emplace_front(Args&&... args)
+    {
+        if (size_ == capacity_)
+        {
+            T value(std::forward<Args>(args)...);
+            grow();
+            const size_type new_head = (head_ - 1) & (capacity_ - 1);
+            alloc_traits::construct(allocator_, data_ + new_head, std::move(value));
+            head_ = new_head;
+        }
+        else
+        {
+            const size_type new_head = (head_ - 1) & (capacity_ - 1);
+            alloc_traits::construct(allocator_, data_ + new_head, std::forward<Args>(args)...);
+            head_ = new_head;
+        }
+
+        ++size_;
+        return front();
+    }
+
+    void pop_back()
+    {
+        if (size_ == 0)
+        {
+            return;
+        }
+
+        alloc_traits::destroy(allocator_, data_ + slot(size_ - 1));
+        --size_;
+    }
+
+    void pop_front()
+    {
+        if (size_ == 0)
+        {
+            return;
+        }
+
+        alloc_traits::destroy(allocator_, data_ + head_);
+        head_ = (head_ + 1) & (capacity_ - 1);
+        --size_;
+    }
+
+    void swap(ring_vector& other) noexcept
+    {
+        std::swap(data_, other.data_);
+        std::swap(head_, other.head_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+    }
+
+    friend bool operator==(const ring_vector& a, const ring_vector& b)
+    {
+        return a.size_ == b.size_ && std::equal(a.begin(), a.end(), b.begin());
+    }
+
+private:
+    using alloc_traits = std::allocator_traits<Allocator>;
+
+    T* data_;
+    size_type head_;
+    size_type size_;
+    size_type capacity_;
+    Allocator allocator_;
+
+    size_type slot(size_type index) const
+    {
+        return (head_ + index) & (capacity_ - 1);
+    }
+
+    void grow()
+    {
+        reallocate(capacity_ == 0 ? 1 : 2 * capacity_);
+    }
+
+    // Moves the elements into a new buffer, unwrapped so that head_ is 0.
+    void reallocate(size_type new_capacity)
+    {
+        T* new_data = alloc_traits::allocate(allocator_, new_capacity);
+        auto [first, second] = as_spans();
+
+        if constexpr (std::is_trivially_copyable_v<T>)
+        {
+            if (size_ != 0)
+            {
+                std::memcpy(static_cast<void*>(new_data), first.data(), first.size() * sizeof(T));
+                std::memcpy(static_cast<void*>(new_data + first.size()), second.data(), second.size() * sizeof(T));
+            }
+        }
+        else
+        {
+            T* out = new_data;
+
+            for (std::span<T> segment : {first, second})
+            {
+                for (T& value : segment)
+                {
+                    alloc_traits::construct(allocator_, out++, std::move(value));
+                    alloc_traits::destroy(allocator_, &value);
+                }
+            }
+        }
+
+        if (data_)
+        {
+            alloc_traits::deallocate(allocator_, data_, capacity_);
+        }
+
+        data_ = new_data;
+        head_ = 0;
+        capacity_ = new_capacity;
+    }
+};
+
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "custom_vector.h"
+#include <bit>
+#include <functional>
+
+namespace ctm
+{
+
+// Read-only search index over a sorted ctm::vector, stored in Eytzinger
+// (BFS) order: node k has children 2k and 2k+1, so the top levels of the
+// tree share a handful of cache lines and the next levels can be
+// prefetched. Results are positions in the original sorted vector,
+// computed from the node index, so the index stores nothing beyond one copy
+// of the elements.
+template <typename T, typename Compare = std::less<T>>
+class search_index
+{
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+    // Queries advanced together by the batched lookups.
+    static constexpr size_type batch_width = 16;
+
+    explicit search_index(const ctm::vector<T>& sorted, const Compare& comp = Compare()):
+        tree_(),
+        size_(sorted.size()),
+        comp_(comp)
+    {
+        tree_.resize(size_ + 1);
+        size_type next = 0;
+        build(sorted, next, 1);
+    }
+
+    bool empty() const
+    {
+        return (size_ == 0);
+    }
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+    // Position of the first element not less than key, or size().
+    size_type lower_bound(const T& key) const
+    {
+        return search(key, [this](const T& element, const T& k) { return comp_(element, k); });
+    }
+
+    // Position of the first element greater than key, or size().
+    size_type upper_bound(const T& key) const
+    {
+        return search(key, [this](const T& element, const T& k) { return !comp_(k, element); });
+    }
+
+    // Batched lookups write one position per key to out. Groups of
+    // batch_width queries descend the tree in lockstep so that their cache
+    // misses overlap instead of being paid one after another.
+    void lower_bound(const T* keys, size_type count, size_type* out) const
+    {
+        search_batch(keys, count, out,
+            [this](const T& element, const T& k) { return comp_(element, k); });
+    }
+
+    void upper_bound(const T* keys, size_type count, size_type* out) const
+    {
+        search_batch(keys, count, out,
+            [this](const T& element, const T& k) { return !comp_(k, element); });
+    }
+
+    ctm::vector<size_type> lower_bound(const ctm::vector<T>& keys) const
+    {
+        ctm::vector<size_type> out(keys.size());
+        lower_bound(keys.data(), keys.size(), out.data());
+        return out;
+    }
+
+private:
+    // tree_[0] is unused so that the children of k are 2k and 2k+1
+    ctm::vector<T> tree_;
+    size_type size_;
+    Compare comp_;
+
+    // Node index multiplier that lands four levels down, one cache line of
+    // descendants ahead of the current node.
+    static constexpr size_type prefetch_stride = 16;
+
+    void build(const ctm::vector<T>& sorted, size_type& next, size_type k)
+    {
+        if (k > size_)
+        {
+            return;
+        }
+
+        build(sorted, next, 2 * k);
+        tree_[k] = sorted[next];
+        ++next;
+        build(sorted, next, 2 * k + 1);
+    }
+
+    static void prefetch(const void* address)
+    {
+#if defined(__GNUC__)
+        __builtin_prefetch(address);
+#endif
+    }
+
+    // After the descent k has been shifted left once per level, with a 1
+    // appended for every right turn. The answer is the node where the last
+    // left turn happened: strip the trailing ones and that left turn.
+    size_type resolve(size_type k) const
+    {
+        k >>= std::countr_one(k) + 1;
+        return k == 0 ? size_ : rank(k);
+    }
+
+    // Sorted position of node k. In a perfect tree with the same number of
+    // levels, k's in-order index puts it in the middle of its subtree's
+    // span. Every bottom-level slot before it that this tree lacks shifts
+    // it down by one; the bottom level holds the even in-order indices.
+    size_type rank(size_type k) const
+    {
+        const int levels = std::bit_width(size_);
+        const int below = levels - std::bit_width(k);
+        const size_type perfect = ((2 * k + 1) << below) - (size_type(1) << levels) - 1;
+        const size_type bottom = size_ - ((size_type(1) << (levels - 1)) - 1);
+        const size_type bottom_before = (perfect + 1) / 2;
+        return bottom_before > bottom ? perfect - (bottom_before - bottom) : perfect;
+    }
+
+    template <typename Less>
+    size_type search(const T& key, Less go_right) const
+    {
+        const T* tree = tree_.data();
+        size_type k = 1;
+
+        while (k <= size_)
+        {
+            prefetch(tree + prefetch_stride * k);
+            k = 2 * k + static_cast<size_type>(go_right(tree[k], key));
+        }
+        return resolve(k);
+    }
+
+    template <typename Less>
+    void search_batch(const T* keys, size_type count, size_type* out, Less go_right) const
+    {
+        const T* tree = tree_.data();
+        const int depth = std::bit_width(size_);
+
+        for (size_type base = 0; base < count; base += batch_width)
+        {
+            const size_type group = std::min(batch_width, count - base);
+            size_type k[batch_width];
+
+            for (size_type q = 0; q < group; ++q)
+            {
+                k[q] = 1;
+            }
+
+            // every descent takes depth - 1 or depth steps
+            for (int level = 0; level < depth; ++level)
+            {
+                for (size_type q = 0; q < group; ++q)
+                {
+                    if (k[q] <= size_)
+                    {
+                        prefetch(tree + prefetch_stride * k[q]);
+                        k[q] = 2 * k[q] + static_cast<size_type>(go_right(tree[k[q]], keys[base + q]));
+                    }
+                }
+            }
+
+            for (size_type q = 0; q < group; ++q)
+            {
+                out[base + q] = resolve(k[q]);
+            }
+        }
+    }
+};
+
+};
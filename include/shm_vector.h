@@ -0,0 +1,534 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ctm
+{
+
+// Pointer stored as the distance from itself to its target, so it stays
+// valid in every process that maps the containing segment, whatever the
+// address. Null is encoded as 0, which can never point elsewhere.
+template <typename T>
+class offset_ptr
+{
+public:
+    offset_ptr():
+        offset_(0) {}
+
+    offset_ptr(T* p)
+    {
+        set(p);
+    }
+
+    offset_ptr(const offset_ptr& other)
+    {
+        set(other.get());
+    }
+
+    offset_ptr& operator=(const offset_ptr& other)
+    {
+        set(other.get());
+        return *this;
+    }
+
+    offset_ptr& operator=(T* p)
+    {
+        set(p);
+        return *this;
+    }
+
+    T* get() const
+    {
+        if (offset_ == 0)
+        {
+            return nullptr;
+        }
+        return reinterpret_cast<T*>(reinterpret_cast<std::uintptr_t>(this) + offset_);
+    }
+
+    T* operator->() const
+    {
+        return get();
+    }
+
+    T& operator*() const
+    {
+        return *get();
+    }
+
+    explicit operator bool() const
+    {
+        return offset_ != 0;
+    }
+
+private:
+    std::uintptr_t offset_;
+
+    void set(T* p)
+    {
+        offset_ = p ? reinterpret_cast<std::uintptr_t>(p) - reinterpret_cast<std::uintptr_t>(this) : 0;
+    }
+};
+
+enum class shm_access
+{
+    read_only,
+    read_write
+};
+
+// Vector whose header and elements live in a POSIX shared-memory segment,
+// so several processes share one copy. The whole address range up to
+// max_capacity is mapped up front and the segment is grown with ftruncate,
+// so growth never moves the data and readers never remap.
+//
+// One process writes; any number read. Appends publish the new size with
+// release ordering, so readers may read [0, size()) at any time. In-place
+// changes (set, clear, resize down) are bracketed by a sequence counter;
+// read() retries until it sees a consistent snapshot.
+template <typename T>
+class shm_vector
+{
+    static_assert(std::is_trivially_copyable_v<T>, "shm_vector elements must be trivially copyable");
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+                  "shm_vector needs address-free 64-bit atomics");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using const_iterator = const T*;
+
+    // Creates a new segment, failing if name exists. The creator is the
+    // writer.
+    static shm_vector create(const std::string& name, size_type max_capacity)
+    {
+        const size_type region = region_size(max_capacity);
+        const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+        if (fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+
+        // the name is unlinked on every failure below, so none is left behind
+        int error = 0;
+        void* p = mmap(nullptr, region, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (p == MAP_FAILED)
+        {
+            error = errno;
+        }
+        else if (ftruncate(fd, static_cast<off_t>(data_offset())) != 0)
+        {
+            error = errno;
+            munmap(p, region);
+        }
+
+        if (error != 0)
+        {
+            close(fd);
+            shm_unlink(name.c_str());
+            throw std::system_error(error, std::generic_category(), "create " + name);
+        }
+
+        shm_vector vec(fd, shm_access::read_write, static_cast<unsigned char*>(p), region);
+
+        header* h = ::new (vec.base_) header();
+        h->element_size = sizeof(T);
+        h->max_capacity = max_capacity;
+        h->data = reinterpret_cast<T*>(vec.base_ + data_offset());
+        h->magic.store(header_magic, std::memory_order_release);
+        return vec;
+    }
+
+    // Maps an existing segment. read_write reattaches a writer, e.g. after
+    // the original one restarted; there must still be only one. Throws
+    // std::system_error with errc::resource_unavailable_try_again while the
+    // creator has not finished setting the segment up.
+    static shm_vector open(const std::string& name, shm_access access = shm_access::read_only)
+    {
+        const int fd = shm_open(name.c_str(), access == shm_access::read_only ? O_RDONLY : O_RDWR, 0);
+
+        if (fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+
+        // The creator sizes the segment and then writes the header. Before
+        // that, touching the header would raise SIGBUS, so an unfinished
+        // segment is rejected and the caller may retry.
+        struct stat info;
+
+        if (fstat(fd, &info) != 0)
+        {
+            const int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "fstat " + name);
+        }
+
+        if (static_cast<size_type>(info.st_size) < data_offset())
+        {
+            close(fd);
+            throw std::system_error(std::make_error_code(std::errc::resource_unavailable_try_again),
+                                    "shm_vector segment " + name + " is not initialised yet");
+        }
+
+        // read the header alone to learn how much to map
+        void* head = mmap(nullptr, sizeof(header), PROT_READ, MAP_SHARED, fd, 0);
+
+        if (head == MAP_FAILED)
+        {
+            const int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "mmap " + name);
+        }
+
+        const header* h = static_cast<const header*>(head);
+        const std::uint64_t magic = h->magic.load(std::memory_order_acquire);
+        const bool valid = magic == header_magic && h->element_size == sizeof(T);
+        const size_type max_capacity = h->max_capacity;
+        munmap(head, sizeof(header));
+
+        if (magic == 0)
+        {
+            close(fd);
+            throw std::system_error(std::make_error_code(std::errc::resource_unavailable_try_again),
+                                    "shm_vector segment " + name + " is not initialised yet");
+        }
+
+        if (!valid)
+        {
+            close(fd);
+            throw std::runtime_error("shm_vector segment " + name + " does not hold this element type");
+        }
+
+        const size_type region = region_size(max_capacity);
+        const int protection = access == shm_access::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+        void* p = mmap(nullptr, region, protection, MAP_SHARED, fd, 0);
+
+        if (p == MAP_FAILED)
+        {
+            const int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "mmap " + name);
+        }
+
+        return shm_vector(fd, access, static_cast<unsigned char*>(p), region);
+    }
+
+    static bool remove(const std::string& name)
+    {
+        return shm_unlink(name.c_str()) == 0;
+    }
+
+    shm_vector(shm_vector&& other) noexcept:
+        fd_(std::exchange(other.fd_, -1)),
+        base_(std::exchange(other.base_, nullptr)),
+        mapped_(std::exchange(other.mapped_, 0)),
+        access_(other.access_) {}
+
+    shm_vector& operator=(shm_vector&& other) noexcept
+    {
+        if (this != &other)
+        {
+            unmap();
+            fd_ = std::exchange(other.fd_, -1);
+            base_ = std::exchange(other.base_, nullptr);
+            mapped_ = std::exchange(other.mapped_, 0);
+            access_ = other.access_;
+        }
+        return *this;
+    }
+
+    shm_vector(const shm_vector&) = delete;
+    shm_vector& operator=(const shm_vector&) = delete;
+
+    ~shm_vector()
+    {
+        unmap();
+    }
+
+    // ELEMENT ACCESS
+    const T& operator[](size_type index) const
+    {
+        return data()[index];
+    }
+
+    const T& at(size_type index) const
+    {
+        if (index >= size())
+        {
+            throw std::out_of_range("Indexing out of range");
+        }
+        return data()[index];
+    }
+
+    const T* data() const
+    {
+        return head()->data.get();
+    }
+
+    const_iterator begin() const
+    {
+        return data();
+    }
+
+    const_iterator end() const
+    {
+        return data() + size();
+    }
+
+    // Calls fn with a span over the elements, retrying if the writer changed
+    // elements in place meanwhile. fn may run more than once, so it should
+    // only copy or compute from what it reads.
+    template <typename Fn>
+    auto read(Fn fn) const
+    {
+        const header* h = head();
+
+        while (true)
+        {
+            const std::uint64_t before = h->sequence.load(std::memory_order_acquire);
+
+            if (before & 1)
+            {
+                continue;
+            }
+
+            auto result = fn(std::span<const T>(data(), size()));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (h->sequence.load(std::memory_order_relaxed) == before)
+            {
+                return result;
+            }
+        }
+    }
+
+    // CAPACITY
+    bool empty() const
+    {
+        return (size() == 0);
+    }
+
+    size_type size() const
+    {
+        return head()->size.load(std::memory_order_acquire);
+    }
+
+    size_type capacity() const
+    {
+        return head()->capacity.load(std::memory_order_acquire);
+    }
+
+    size_type max_capacity() const
+    {
+        return head()->max_capacity;
+    }
+
+    bool writable() const
+    {
+        return access_ == shm_access::read_write;
+    }
+
+    // Grows the segment to hold new_capacity elements.
+    void reserve(size_type new_capacity)
+    {
+        check_writable();
+        header* h = head();
+
+        if (new_capacity <= h->capacity.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        if (new_capacity > h->max_capacity)
+        {
+            throw std::length_error("shm_vector capacity exceeds max_capacity");
+        }
+
+        if (ftruncate(fd_, static_cast<off_t>(data_offset() + new_capacity * sizeof(T))) != 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "ftruncate");
+        }
+        h->capacity.store(new_capacity, std::memory_order_release);
+    }
+
+    // MODIFIERS
+    void push_back(const T& value)
+    {
+        append(&value, 1);
+    }
+
+    // Copies count elements to the end, then publishes the new size.
+    void append(const T* values, size_type count)
+    {
+        check_writable();
+        header* h = head();
+        const size_type old_size = h->size.load(std::memory_order_relaxed);
+
+        if (old_size + count > h->capacity.load(std::memory_order_relaxed))
+        {
+            size_type new_capacity = std::max<size_type>(h->capacity.load(std::memory_order_relaxed), 1);
+
+            while (new_capacity < old_size + count)
+            {
+                new_capacity *= 2;
+            }
+            reserve(std::min(new_capacity, std::max(h->max_capacity, old_size + count)));
+        }
+
+        std::memcpy(static_cast<void*>(writable_data() + old_size), values, count * sizeof(T));
+        h->size.store(old_size + count, std::memory_order_release);
+    }
+
+    // Overwrites one element under the sequence counter.
+    void set(size_type index, const T& value)
+    {
+        check_writable();
+
+        if (index >= size())
+        {
+            throw std::out_of_range("Indexing out of range");
+        }
+
+        begin_write();
+        std::memcpy(static_cast<void*>(writable_data() + index), &value, sizeof(T));
+        end_write();
+    }
+
+    void resize(size_type count, const T& value = T())
+    {
+        check_writable();
+        const size_type old_size = size();
+
+        if (count <= old_size)
+        {
+            begin_write();
+            head()->size.store(count, std::memory_order_release);
+            end_write();
+            return;
+        }
+
+        reserve(count);
+        T* out = writable_data();
+
+        for (size_type i = old_size; i < count; ++i)
+        {
+            std::memcpy(static_cast<void*>(out + i), &value, sizeof(T));
+        }
+        head()->size.store(count, std::memory_order_release);
+    }
+
+    void clear()
+    {
+        resize(0);
+    }
+
+private:
+    struct header
+    {
+        std::atomic<std::uint64_t> magic{0};
+        std::uint64_t element_size = 0;
+        std::uint64_t max_capacity = 0;
+        std::atomic<std::uint64_t> size{0};
+        std::atomic<std::uint64_t> capacity{0};
+        std::atomic<std::uint64_t> sequence{0};
+        offset_ptr<T> data;
+    };
+
+    static constexpr std::uint64_t header_magic = 0x6374'6d73'686d'7631; // "ctmshmv1"
+
+    int fd_;
+    unsigned char* base_;
+    size_type mapped_;
+    shm_access access_;
+
+    // takes ownership of an open descriptor and its mapping
+    shm_vector(int fd, shm_access access, unsigned char* base, size_type region):
+        fd_(fd),
+        base_(base),
+        mapped_(region),
+        access_(access) {}
+
+    // elements start on their own cache line after the header
+    static constexpr size_type data_offset()
+    {
+        constexpr size_type alignment = alignof(T) > 64 ? alignof(T) : 64;
+        return (sizeof(header) + alignment - 1) / alignment * alignment;
+    }
+
+    static size_type region_size(size_type max_capacity)
+    {
+        if (max_capacity > (std::numeric_limits<size_type>::max() - data_offset()) / sizeof(T))
+        {
+            throw std::length_error("shm_vector max_capacity too large");
+        }
+        return data_offset() + max_capacity * sizeof(T);
+    }
+
+    header* head() const
+    {
+        return reinterpret_cast<header*>(base_);
+    }
+
+    T* writable_data()
+    {
+        return head()->data.get();
+    }
+
+    void check_writable() const
+    {
+        if (access_ != shm_access::read_write)
+        {
+            throw std::logic_error("shm_vector is mapped read-only");
+        }
+    }
+
+    void begin_write()
+    {
+        header* h = head();
+        h->sequence.store(h->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void end_write()
+    {
+        header* h = head();
+        h->sequence.store(h->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void unmap()
+    {
+        if (base_)
+        {
+            munmap(base_, mapped_);
+            base_ = nullptr;
+        }
+
+        if (fd_ >= 0)
+        {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+};
+
+};
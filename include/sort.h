@@ -0,0 +1,365 @@
+#pragma once
+
+#include "custom_vector.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <ranges>
+#include <type_traits>
+
+namespace ctm
+{
+
+namespace detail
+{
+
+// Element types sorted by value with the LSD radix sort.
+template <typename T>
+inline constexpr bool radix_sortable =
+    (std::is_integral_v<T> && !std::is_same_v<T, bool>) ||
+    std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+template <typename T>
+using radix_bits_t = std::conditional_t<sizeof(T) == 1, std::uint8_t,
+                     std::conditional_t<sizeof(T) == 2, std::uint16_t,
+                     std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>>>;
+
+// Maps a key to an unsigned integer with the same order: the sign bit of
+// signed integers is flipped, negative floats are inverted and positive
+// floats get their sign bit set. NaNs sort after +inf (or before -inf when
+// their sign bit is set).
+template <typename T>
+inline radix_bits_t<T> radix_bits(T key)
+{
+    using bits_t = radix_bits_t<T>;
+    constexpr bits_t sign = bits_t(1) << (8 * sizeof(T) - 1);
+    const bits_t bits = std::bit_cast<bits_t>(key);
+
+    if constexpr (std::is_floating_point_v<T>)
+    {
+        return (bits & sign) ? static_cast<bits_t>(~bits) : static_cast<bits_t>(bits | sign);
+    }
+    else if constexpr (std::is_signed_v<T>)
+    {
+        return static_cast<bits_t>(bits ^ sign);
+    }
+    else
+    {
+        return bits;
+    }
+}
+
+// Below this many elements per thread, splitting the work costs more than
+// it saves.
+inline constexpr std::size_t parallel_sort_grain = std::size_t(1) << 16;
+
+inline std::size_t sort_parts(std::size_t n, const thread_pool& pool)
+{
+    return std::clamp<std::size_t>(n / parallel_sort_grain, 1, pool.size());
+}
+
+// Stable LSD radix sort of n trivially copyable items by the unsigned key
+// bits(item), one byte per pass. Each part counts its slice, the counts are
+// turned into per-part bucket offsets, and the parts scatter in parallel.
+// Passes in which every key has the same byte are skipped. Returns the
+// buffer holding the result, either items or scratch.
+template <typename Item, typename Bits>
+Item* radix_sort_items(Item* items, Item* scratch, std::size_t n, Bits bits, thread_pool& pool)
+{
+    using key_t = decltype(bits(*items));
+    constexpr std::size_t passes = sizeof(key_t);
+    const std::size_t parts = sort_parts(n, pool);
+    const std::size_t part_size = (n + parts - 1) / parts;
+
+    // one histogram per pass over all items, to find passes to skip
+    ctm::vector<std::array<std::size_t, 256 * passes>> totals(parts);
+
+    pool.parallel_for(parts, [&](std::size_t part)
+    {
+        std::array<std::size_t, 256 * passes>& count = totals[part];
+        count.fill(0);
+        const std::size_t last = std::min(n, (part + 1) * part_size);
+
+        for (std::size_t i = part * part_size; i < last; ++i)
+        {
+            const key_t key = bits(items[i]);
+
+            for (std::size_t pass = 0; pass < passes; ++pass)
+            {
+                ++count[256 * pass + ((key >> (8 * pass)) & 0xff)];
+            }
+        }
+    });
+
+    ctm::vector<std::array<std::size_t, 256>> offsets(parts);
+    Item* from = items;
+    Item* to = scratch;
+
+    for (std::size_t pass = 0; pass < passes; ++pass)
+    {
+        const std::size_t shift = 8 * pass;
+        bool trivial = false;
+
+        for (std::size_t digit = 0; digit < 256 && !trivial; ++digit)
+        {
+            std::size_t total = 0;
+
+            for (std::size_t part = 0; part < parts; ++part)
+            {
+                total += totals[part][256 * pass + digit];
+            }
+            trivial = (total == n);
+        }
+
+        if (trivial)
+        {
+            continue;
+        }
+
+        // counts of this digit per part over the current order; a single
+        // part already has them from the first histogram
+        pool.parallel_for(parts, [&](std::size_t part)
+        {
+            if (parts == 1)
+            {
+                std::copy_n(totals[0].begin() + 256 * pass, 256, offsets[0].begin());
+                return;
+            }
+
+            std::array<std::size_t, 256>& count = offsets[part];
+            count.fill(0);
+            const std::size_t last = std::min(n, (part + 1) * part_size);
+
+            for (std::size_t i = part * part_size; i < last; ++i)
+            {
+                ++count[(bits(from[i]) >> shift) & 0xff];
+            }
+        });
+
+        std::size_t running = 0;
+
+        for (std::size_t digit = 0; digit < 256; ++digit)
+        {
+            for (std::size_t part = 0; part < parts; ++part)
+            {
+                const std::size_t count = offsets[part][digit];
+                offsets[part][digit] = running;
+                running += count;
+            }
+        }
+
+        pool.parallel_for(parts, [&](std::size_t part)
+        {
+            std::array<std::size_t, 256>& next = offsets[part];
+            const std::size_t last = std::min(n, (part + 1) * part_size);
+
+            for (std::size_t i = part * part_size; i < last; ++i)
+            {
+                to[next[(bits(from[i]) >> shift) & 0xff]++] = from[i];
+            }
+        });
+
+        std::swap(from, to);
+    }
+    return from;
+}
+
+// Finds how many of the first k merged outputs come from a (the rest come
+// from b), so that independent slices of one merge can run in parallel.
+template <typename It, typename Compare>
+std::size_t merge_split(It a, std::size_t na, It b, std::size_t nb, std::size_t k, Compare& comp)
+{
+    std::size_t low = k > nb ? k - nb : 0;
+    std::size_t high = std::min(k, na);
+
+    while (low < high)
+    {
+        const std::size_t i = low + (high - low) / 2;
+
+        // a[i] goes before b[k - i - 1] unless b's element is strictly smaller
+        if (comp(b[k - i - 1], a[i]))
+        {
+            high = i;
+        }
+        else
+        {
+            low = i + 1;
+        }
+    }
+    return low;
+}
+
+template <typename It, typename Out, typename Compare>
+void move_merge(It a, It a_end, It b, It b_end, Out out, Compare& comp)
+{
+    while (a != a_end && b != b_end)
+    {
+        if (comp(*b, *a))
+        {
+            *out++ = std::move(*b++);
+        }
+        else
+        {
+            *out++ = std::move(*a++);
+        }
+    }
+    out = std::move(a, a_end, out);
+    std::move(b, b_end, out);
+}
+
+};
+
+// Sorts with a parallel merge sort: every thread sorts one run, then pairs
+// of runs are merged round by round, each merge split into slices so all
+// threads stay busy. The scratch buffer comes from the vector's allocator.
+template <typename T, typename Allocator, typename Compare>
+void sort(vector<T, Allocator>& vec, Compare comp, thread_pool& pool = thread_pool::instance())
+{
+    const std::size_t n = vec.size();
+    const std::size_t runs = detail::sort_parts(n, pool);
+
+    if (runs == 1)
+    {
+        std::sort(vec.begin(), vec.end(), comp);
+        return;
+    }
+
+    ctm::vector<std::size_t> bounds(runs + 1);
+
+    for (std::size_t r = 0; r <= runs; ++r)
+    {
+        bounds[r] = n * r / runs;
+    }
+
+    pool.parallel_for(runs, [&](std::size_t r)
+    {
+        std::sort(vec.begin() + bounds[r], vec.begin() + bounds[r + 1], comp);
+    });
+
+    ctm::vector<T, Allocator> scratch(vec.get_allocator());
+    scratch.reserve(n);
+    scratch.insert(scratch.end(), std::make_move_iterator(vec.begin()), std::make_move_iterator(vec.end()));
+    T* from = scratch.data();
+    T* to = vec.data();
+
+    struct slice
+    {
+        std::size_t a, a_end, b, b_end, out;
+    };
+
+    while (bounds.size() > 2)
+    {
+        ctm::vector<slice> slices;
+        ctm::vector<std::size_t> merged{0};
+
+        for (std::size_t r = 0; r + 1 < bounds.size(); r += 2)
+        {
+            const std::size_t lo = bounds[r];
+            const std::size_t mid = bounds[r + 1];
+            const std::size_t hi = r + 2 < bounds.size() ? bounds[r + 2] : mid;
+            const std::size_t pieces = std::max<std::size_t>(1, pool.size() * (hi - lo) / n);
+            std::size_t prev_a = 0;
+
+            for (std::size_t p = 1; p <= pieces; ++p)
+            {
+                const std::size_t k = (hi - lo) * p / pieces;
+                const std::size_t a = detail::merge_split(from + lo, mid - lo, from + mid, hi - mid, k, comp);
+                const std::size_t prev_k = (hi - lo) * (p - 1) / pieces;
+                slices.push_back(slice{lo + prev_a, lo + a, mid + (prev_k - prev_a), mid + (k - a), lo + prev_k});
+                prev_a = a;
+            }
+            merged.push_back(hi);
+        }
+
+        pool.parallel_for(slices.size(), [&](std::size_t s)
+        {
+            const slice& sl = slices[s];
+            detail::move_merge(from + sl.a, from + sl.a_end, from + sl.b, from + sl.b_end, to + sl.out, comp);
+        });
+
+        bounds.swap(merged);
+        std::swap(from, to);
+    }
+
+    if (from != vec.data())
+    {
+        std::move(from, from + n, vec.data());
+    }
+}
+
+// Sorts in ascending order. Integers, float and double use a parallel LSD
+// radix sort; other types use the parallel merge sort with std::less.
+template <typename T, typename Allocator>
+void sort(vector<T, Allocator>& vec, thread_pool& pool = thread_pool::instance())
+{
+    if constexpr (detail::radix_sortable<T>)
+    {
+        const std::size_t n = vec.size();
+
+        if (n < 256)
+        {
+            std::sort(vec.begin(), vec.end());
+            return;
+        }
+
+        // scratch capacity is written as raw storage of a trivial type
+        ctm::vector<T, Allocator> scratch(vec.get_allocator());
+        scratch.reserve(n);
+        T* result = detail::radix_sort_items(vec.data(), scratch.data(), n,
+            [](T value) { return detail::radix_bits(value); }, pool);
+
+        if (result != vec.data())
+        {
+            std::memcpy(vec.data(), result, n * sizeof(T));
+        }
+    }
+    else
+    {
+        ctm::sort(vec, std::less<T>(), pool);
+    }
+}
+
+// Stable sort by an extracted integer or floating-point key. Keys and
+// positions are radix sorted together, then the elements are moved once
+// into their final order.
+template <typename T, typename Allocator, typename KeyFn>
+void sort_by_key(vector<T, Allocator>& vec, KeyFn key, thread_pool& pool = thread_pool::instance())
+{
+    using key_t = std::remove_cvref_t<std::invoke_result_t<KeyFn&, const T&>>;
+    static_assert(detail::radix_sortable<key_t>, "sort_by_key needs an integer or floating-point key");
+
+    struct keyed
+    {
+        detail::radix_bits_t<key_t> bits;
+        std::size_t index;
+    };
+
+    using keyed_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<keyed>;
+    const std::size_t n = vec.size();
+    ctm::vector<keyed, keyed_allocator> items(keyed_allocator(vec.get_allocator()));
+    items.reserve(n);
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        items.push_back(keyed{detail::radix_bits(static_cast<key_t>(std::invoke(key, vec[i]))), i});
+    }
+
+    ctm::vector<keyed, keyed_allocator> scratch(keyed_allocator(vec.get_allocator()));
+    scratch.reserve(n);
+    const keyed* order = detail::radix_sort_items(items.data(), scratch.data(), n,
+        [](const keyed& item) { return item.bits; }, pool);
+
+    ctm::vector<T, Allocator> sorted(vec.get_allocator());
+    sorted.reserve(vec.capacity());
+    sorted.append_range(std::views::iota(std::size_t(0), n) |
+        std::views::transform([&](std::size_t i) -> T&& { return std::move(vec[order[i].index]); }));
+    vec.swap(sorted);
+}
+
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace ctm
+{
+
+// Bulk fills and copies of trivially copyable elements at least this many
+// bytes long bypass the cache with non-temporal stores, so initialising a
+// buffer much larger than the last-level cache does not evict the working
+// set of other threads. The default sits above typical LLC sizes.
+inline constexpr std::size_t streaming_always = 0;
+inline constexpr std::size_t streaming_never = std::numeric_limits<std::size_t>::max();
+
+namespace detail
+{
+
+inline std::atomic<std::size_t> streaming_threshold_bytes{std::size_t(32) * 1024 * 1024};
+
+};
+
+// Pass streaming_always or streaming_never to force either policy.
+inline void set_streaming_threshold(std::size_t bytes)
+{
+    detail::streaming_threshold_bytes.store(bytes, std::memory_order_relaxed);
+}
+
+inline std::size_t streaming_threshold()
+{
+    return detail::streaming_threshold_bytes.load(std::memory_order_relaxed);
+}
+
+namespace detail
+{
+
+inline bool use_streaming_stores(std::size_t bytes)
+{
+#if defined(__SSE2__)
+    return bytes >= streaming_threshold();
+#else
+    (void)bytes;
+    return false;
+#endif
+}
+
+#if defined(__SSE2__)
+
+// Writes bytes from src to dst with 16-byte non-temporal stores; the
+// unaligned head and tail of dst are copied normally.
+inline void stream_copy(void* dst, const void* src, std::size_t bytes)
+{
+    char* out = static_cast<char*>(dst);
+    const char* in = static_cast<const char*>(src);
+    const std::size_t head = std::min(bytes, (16 - reinterpret_cast<std::uintptr_t>(out) % 16) % 16);
+
+    std::memcpy(out, in, head);
+    out += head;
+    in += head;
+    bytes -= head;
+
+    for (; bytes >= 64; bytes -= 64, out += 64, in += 64)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 32));
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out + 48), d);
+    }
+
+    for (; bytes >= 16; bytes -= 16, out += 16, in += 16)
+    {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out),
+                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+    }
+
+    std::memcpy(out, in, bytes);
+    // order the weakly ordered stores before any later store
+    _mm_sfence();
+}
+
+// Fills count elements with value using non-temporal stores. Only element
+// sizes that divide 16 can be broadcast into a register; the caller checks.
+template <typename T>
+inline void stream_fill(T* dst, std::size_t count, const T& value)
+{
+    static_assert(16 % sizeof(T) == 0, "stream_fill needs an element size dividing 16");
+
+    std::size_t i = 0;
+
+    for (; i < count && reinterpret_cast<std::uintptr_t>(dst + i) % 16 != 0; ++i)
+    {
+        std::memcpy(static_cast<void*>(dst + i), &value, sizeof(T));
+    }
+
+    alignas(16) unsigned char pattern[16];
+
+    for (std::size_t b = 0; b < 16; b += sizeof(T))
+    {
+        std::memcpy(pattern + b, &value, sizeof(T));
+    }
+
+    const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(pattern));
+    constexpr std::size_t per_vector = 16 / sizeof(T);
+    char* out = reinterpret_cast<char*>(dst + i);
+
+    for (; i + 4 * per_vector <= count; i += 4 * per_vector, out += 64)
+    {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out), v);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out + 16), v);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out + 32), v);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out + 48), v);
+    }
+
+    for (; i + per_vector <= count; i += per_vector, out += 16)
+    {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out), v);
+    }
+
+    for (; i < count; ++i)
+    {
+        std::memcpy(static_cast<void*>(dst + i), &value, sizeof(T));
+    }
+    _mm_sfence();
+}
+
+#endif
+
+};
+
+};
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ctm
+{
+
+// Fixed set of worker threads that run one parallel_for at a time. The
+// calling thread takes part in the work, so a pool of size n starts n - 1
+// workers; size 1 runs everything inline.
+class thread_pool
+{
+public:
+    explicit thread_pool(std::size_t threads = std::max(1u, std::thread::hardware_concurrency())):
+        tasks_(0),
+        next_(0),
+        active_(0),
+        generation_(0),
+        stop_(false),
+        job_(nullptr),
+        context_(nullptr)
+    {
+        for (std::size_t i = 1; i < std::max<std::size_t>(threads, 1); ++i)
+        {
+            workers_.emplace_back([this]() { worker_loop(); });
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+
+        for (std::thread& worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    // Threads that work on a parallel_for, including the caller.
+    std::size_t size() const
+    {
+        return workers_.size() + 1;
+    }
+
+    // Process-wide pool with one thread per hardware thread.
+    static thread_pool& instance()
+    {
+        static thread_pool pool;
+        return pool;
+    }
+
+    // Calls fn(task) for every task in [0, tasks) and returns once all have
+    // finished. The first exception thrown by fn is rethrown here. Calls
+    // from inside a task run serially instead of deadlocking.
+    template <typename Fn>
+    void parallel_for(std::size_t tasks, Fn&& fn)
+    {
+        if (tasks == 0)
+        {
+            return;
+        }
+
+        if (tasks == 1 || workers_.empty() || in_task())
+        {
+            for (std::size_t task = 0; task < tasks; ++task)
+            {
+                fn(task);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> submit(submit_mutex_);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = [](void* context, std::size_t task)
+            {
+                (*static_cast<std::remove_reference_t<Fn>*>(context))(task);
+            };
+            context_ = const_cast<void*>(static_cast<const void*>(std::addressof(fn)));
+            tasks_ = tasks;
+            next_.store(0, std::memory_order_relaxed);
+            active_ = workers_.size();
+            error_ = nullptr;
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        run_tasks();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return active_ == 0; });
+
+        if (error_)
+        {
+            std::rethrow_exception(error_);
+        }
+    }
+
+private:
+    using job_function = void (*)(void* context, std::size_t task);
+
+    std::vector<std::thread> workers_;
+    std::mutex submit_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::size_t tasks_;
+    std::atomic<std::size_t> next_;
+    std::size_t active_;
+    std::size_t generation_;
+    bool stop_;
+    job_function job_;
+    void* context_;
+    std::exception_ptr error_;
+
+    static bool& in_task()
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+
+    void run_tasks()
+    {
+        in_task() = true;
+
+        for (std::size_t task = next_.fetch_add(1, std::memory_order_relaxed); task < tasks_;
+             task = next_.fetch_add(1, std::memory_order_relaxed))
+        {
+            try
+            {
+                job_(context_, task);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                if (!error_)
+                {
+                    error_ = std::current_exception();
+                }
+            }
+        }
+
+        in_task() = false;
+    }
+
+    void worker_loop()
+    {
+        std::size_t seen = 0;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this, seen]() { return stop_ || generation_ != seen; });
+
+                if (stop_)
+                {
+                    return;
+                }
+                seen = generation_;
+            }
+
+            run_tasks();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (--active_ == 0)
+            {
+                done_.notify_one();
+            }
+        }
+    }
+};
+
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+
+namespace ctm
+{
+
+namespace detail
+{
+
+class trim_list
+{
+public:
+    using callback = std::function<std::size_t()>;
+    using handle = std::list<callback>::iterator;
+
+    static trim_list& instance()
+    {
+        static trim_list list;
+        return list;
+    }
+
+    handle add(callback fn)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return callbacks_.insert(callbacks_.end(), std::move(fn));
+    }
+
+    void remove(handle h)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        callbacks_.erase(h);
+    }
+
+    std::size_t trim()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::size_t released = 0;
+
+        for (callback& fn : callbacks_)
+        {
+            released += fn();
+        }
+        return released;
+    }
+
+private:
+    std::mutex mutex_;
+    std::list<callback> callbacks_;
+};
+
+};
+
+// Keeps a trim callback in the process-wide trim list until destroyed.
+class trim_registration
+{
+public:
+    trim_registration():
+        handle_(),
+        active_(false) {}
+
+    explicit trim_registration(std::function<std::size_t()> fn):
+        handle_(detail::trim_list::instance().add(std::move(fn))),
+        active_(true) {}
+
+    trim_registration(trim_registration&& other) noexcept:
+        handle_(other.handle_),
+        active_(other.active_)
+    {
+        other.active_ = false;
+    }
+
+    trim_registration& operator=(trim_registration&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            handle_ = other.handle_;
+            active_ = other.active_;
+            other.active_ = false;
+        }
+        return *this;
+    }
+
+    trim_registration(const trim_registration&) = delete;
+    trim_registration& operator=(const trim_registration&) = delete;
+
+    ~trim_registration()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        if (active_)
+        {
+            detail::trim_list::instance().remove(handle_);
+            active_ = false;
+        }
+    }
+
+private:
+    detail::trim_list::handle handle_;
+    bool active_;
+};
+
+// Registers a container whose spare capacity trim_all() may release with
+// shrink_to_fit(). The container must stay at the same address while the
+// registration lives, and must not be in use by another thread while
+// trim_all() runs.
+template <typename Container>
+trim_registration register_for_trim(Container& container)
+{
+    return trim_registration([&container]() -> std::size_t
+    {
+        using value_type = typename Container::value_type;
+        const std::size_t before = container.capacity();
+        container.shrink_to_fit();
+        return (before - container.capacity()) * sizeof(value_type);
+    });
+}
+
+// Runs every registered trim callback on the calling thread, e.g. from a
+// memory-pressure handler. Returns the number of bytes released.
+inline std::size_t trim_all()
+{
+    return detail::trim_list::instance().trim();
+}
+
+};
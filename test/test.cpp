@@ -1,6 +1,37 @@
 #include <gtest/gtest.h>
 #include "custom_vector.h"
+#include "bit_vector.h"
+#include "packed_int_vector.h"
+#include "allocation_stats.h"
+#include "realloc_trace.h"
+#include "flat_map.h"
+#include "flat_set.h"
+#include "search_index.h"
+#include "trim_registry.h"
+#include "recycling_allocator.h"
+#include "compact_vector.h"
+#include "jagged_vector.h"
+#include "ring_vector.h"
+#include "incremental_vector.h"
+#include "sort.h"
+#include "rcu_vector.h"
+#include <algorithm>
+#include <list>
+#include <ranges>
+#include <span>
+#include <array>
 #include <string>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <numeric>
+#include <memory>
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "shm_vector.h"
+#endif
 
 struct S
 {
@@ -1065,6 +1096,2174 @@ TEST(Swap, Default)
     }
 }
 
+TEST(BitVector, PushBackAndAccess)
+{
+    ctm::bit_vector bits;
+
+    for (int i = 0; i < 200; ++i)
+    {
+        bits.push_back(i % 3 == 0);
+    }
+
+    EXPECT_EQ(bits.size(), 200);
+    EXPECT_EQ(bits.num_words(), 4);
+
+    for (int i = 0; i < 200; ++i)
+    {
+        EXPECT_EQ(bits[i], i % 3 == 0);
+    }
+
+    bits[1] = true;
+    bits[0] = false;
+    EXPECT_TRUE(bits[1]);
+    EXPECT_FALSE(bits[0]);
+    bits[2] = bits[1];
+    EXPECT_TRUE(bits.test(2));
+
+    EXPECT_THROW([&bits](){
+        bits.test(200);
+    }(), std::out_of_range);
+
+    bits.pop_back();
+    EXPECT_EQ(bits.size(), 199);
+}
+
+TEST(BitVector, ResizeKeepsTailClear)
+{
+    ctm::bit_vector bits(70, true);
+    EXPECT_EQ(bits.count(), 70);
+    EXPECT_TRUE(bits.all());
+
+    bits.resize(130, false);
+    EXPECT_EQ(bits.count(), 70);
+    bits.resize(200, true);
+    EXPECT_EQ(bits.count(), 140);
+    EXPECT_FALSE(bits[100]);
+    EXPECT_TRUE(bits[130]);
+
+    bits.flip();
+    EXPECT_EQ(bits.count(), 60);
+    bits.resize(10);
+    EXPECT_EQ(bits.count(), 0);
+    EXPECT_TRUE(bits.none());
+}
+
+TEST(BitVector, FindRankSelect)
+{
+    ctm::bit_vector bits(1000);
+    ctm::vector<std::size_t> positions{{3, 64, 65, 127, 500, 999}};
+
+    for (std::size_t pos : positions)
+    {
+        bits.set(pos);
+    }
+
+    std::size_t k = 0;
+    for (std::size_t pos = bits.find_first(); pos != ctm::bit_vector::npos;
+         pos = bits.find_next(pos))
+    {
+        EXPECT_EQ(pos, positions[k]);
+        ++k;
+    }
+    EXPECT_EQ(k, positions.size());
+
+    ctm::rank_select index(bits);
+
+    for (std::size_t i = 0; i < positions.size(); ++i)
+    {
+        EXPECT_EQ(bits.rank(positions[i]), i);
+        EXPECT_EQ(index.rank(positions[i]), i);
+        EXPECT_EQ(index.rank(positions[i] + 1), i + 1);
+        EXPECT_EQ(bits.select(i), positions[i]);
+        EXPECT_EQ(index.select(i), positions[i]);
+    }
+
+    EXPECT_EQ(bits.select(positions.size()), ctm::bit_vector::npos);
+    EXPECT_EQ(index.select(positions.size()), ctm::bit_vector::npos);
+    EXPECT_EQ(index.rank(1000), positions.size());
+}
+
+TEST(BitVector, WordParallelOperations)
+{
+    ctm::bit_vector a(300), b(300);
+
+    for (int i = 0; i < 300; ++i)
+    {
+        a[i] = (i % 2 == 0);
+        b[i] = (i % 3 == 0);
+    }
+
+    ctm::bit_vector and_bits = a & b;
+    ctm::bit_vector or_bits = a | b;
+    ctm::bit_vector xor_bits = a ^ b;
+    ctm::bit_vector and_not_bits = a;
+    and_not_bits.and_not(b);
+
+    for (int i = 0; i < 300; ++i)
+    {
+        EXPECT_EQ(and_bits[i], a[i] && b[i]);
+        EXPECT_EQ(or_bits[i], a[i] || b[i]);
+        EXPECT_EQ(xor_bits[i], a[i] != b[i]);
+        EXPECT_EQ(and_not_bits[i], a[i] && !b[i]);
+    }
+
+    EXPECT_EQ(and_bits.count(), 50);
+    EXPECT_EQ(or_bits.count(), 200);
+
+    ctm::bit_vector c(10);
+    EXPECT_THROW([&](){
+        a &= c;
+    }(), std::invalid_argument);
+}
+
+TEST(PackedIntVector, PlainAutoWidth)
+{
+    ctm::vector<std::uint64_t> values;
+
+    for (std::uint64_t i = 0; i < 1000; ++i)
+    {
+        values.push_back((i * 37) % 1000);
+    }
+
+    ctm::packed_int_vector<> packed(values);
+    EXPECT_EQ(packed.size(), 1000);
+    EXPECT_EQ(packed.bit_width(), 10);
+    EXPECT_LT(packed.memory_bytes(), values.size() * sizeof(std::uint64_t) / 4);
+
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        EXPECT_EQ(packed[i], values[i]);
+    }
+
+    ctm::vector<std::uint32_t> decoded;
+    packed.decode(decoded);
+    EXPECT_EQ(decoded.size(), values.size());
+
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        EXPECT_EQ(decoded[i], values[i]);
+    }
+
+    EXPECT_THROW([&packed](){
+        packed.at(1000);
+    }(), std::out_of_range);
+
+    // push_back widens auto-width vectors, default-constructed or not
+    packed.push_back(5000);
+    EXPECT_EQ(packed.bit_width(), 13);
+    EXPECT_EQ(packed[999], values[999]);
+    EXPECT_EQ(packed[1000], 5000);
+
+    ctm::packed_int_vector<> grown;
+    EXPECT_EQ(grown.bit_width(), 1);
+
+    for (std::uint64_t i = 0; i < 200; ++i)
+    {
+        grown.push_back(i * i);
+    }
+
+    grown.push_back(~std::uint64_t(0));
+    EXPECT_EQ(grown.bit_width(), 64);
+    EXPECT_EQ(grown.size(), 201);
+
+    for (std::uint64_t i = 0; i < 200; ++i)
+    {
+        EXPECT_EQ(grown[i], i * i);
+    }
+    EXPECT_EQ(grown[200], ~std::uint64_t(0));
+}
+
+TEST(PackedIntVector, FixedWidth)
+{
+    ctm::packed_int_vector<7> packed;
+
+    for (std::uint64_t i = 0; i < 300; ++i)
+    {
+        packed.push_back(i % 128);
+    }
+
+    EXPECT_EQ(packed.bit_width(), 7);
+
+    for (std::size_t i = 0; i < 300; ++i)
+    {
+        EXPECT_EQ(packed[i], i % 128);
+    }
+
+    EXPECT_THROW([&packed](){
+        packed.push_back(128);
+    }(), std::out_of_range);
+
+    ctm::vector<std::uint64_t> wide{{1, 2, 1000}};
+    EXPECT_THROW([&wide](){
+        ctm::packed_int_vector<7> too_narrow(wide);
+    }(), std::out_of_range);
+
+    ctm::vector<std::uint64_t> full{{~std::uint64_t(0), 0, 12345}};
+    ctm::packed_int_vector<64> packed64(full);
+
+    for (std::size_t i = 0; i < full.size(); ++i)
+    {
+        EXPECT_EQ(packed64[i], full[i]);
+    }
+}
+
+TEST(PackedIntVector, DeltaAndFrameOfReference)
+{
+    ctm::vector<std::uint64_t> values;
+    std::uint64_t current = 1000000;
+
+    for (std::uint64_t i = 0; i < 1000; ++i)
+    {
+        current += (i * 7) % 13;
+        values.push_back(current);
+    }
+
+    ctm::packed_int_vector<> delta(values, ctm::packing::delta);
+    ctm::packed_int_vector<> for_packed(values, ctm::packing::frame_of_reference);
+    EXPECT_EQ(delta.bit_width(), 4);
+    EXPECT_LT(delta.bit_width(), for_packed.bit_width());
+
+    ctm::vector<std::uint32_t> delta_decoded, for_decoded;
+    delta.decode(delta_decoded);
+    for_packed.decode(for_decoded);
+
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        EXPECT_EQ(delta[i], values[i]);
+        EXPECT_EQ(for_packed[i], values[i]);
+        EXPECT_EQ(delta_decoded[i], values[i]);
+        EXPECT_EQ(for_decoded[i], values[i]);
+    }
+
+    ctm::vector<std::uint64_t> unsorted{{5, 3}};
+    EXPECT_THROW([&unsorted](){
+        ctm::packed_int_vector<> bad(unsorted, ctm::packing::delta);
+    }(), std::invalid_argument);
+}
+
+TEST(AllocationStats, RecordAndAggregate)
+{
+    const ctm::allocation_stats before = ctm::get_allocation_stats();
+
+    ctm::detail::record_allocation(100);
+    ctm::detail::record_allocation(4096);
+
+    std::thread worker([](){
+        ctm::detail::record_allocation(1 << 20);
+        ctm::detail::record_deallocation(1 << 20);
+    });
+    worker.join();
+
+    ctm::detail::record_deallocation(100);
+
+    const ctm::allocation_stats after = ctm::get_allocation_stats();
+    EXPECT_EQ(after.allocations - before.allocations, 3);
+    EXPECT_EQ(after.deallocations - before.deallocations, 2);
+    EXPECT_EQ(after.bytes_allocated - before.bytes_allocated, 100 + 4096 + (1 << 20));
+    EXPECT_EQ(after.live_bytes - before.live_bytes, 4096);
+    EXPECT_GE(after.peak_bytes, before.live_bytes + (1 << 20));
+    EXPECT_EQ(after.histogram[7] - before.histogram[7], 1);
+    EXPECT_EQ(after.histogram[12] - before.histogram[12], 1);
+    EXPECT_EQ(after.histogram[20] - before.histogram[20], 1);
+
+    ctm::detail::record_deallocation(4096);
+
+    std::ostringstream os;
+    os << after;
+    EXPECT_NE(os.str().find("allocations="), std::string::npos);
+}
+
+#if defined(CTM_ALLOCATOR_STATS)
+TEST(AllocationStats, VectorAllocations)
+{
+    const ctm::allocation_stats before = ctm::get_allocation_stats();
+
+    {
+        ctm::vector<int> vec;
+
+        for (int i = 0; i < 100; ++i)
+        {
+            vec.push_back(i);
+        }
+
+        const ctm::allocation_stats during = ctm::get_allocation_stats();
+        EXPECT_EQ(during.allocations - before.allocations, 8);
+        EXPECT_EQ(during.live_bytes - before.live_bytes, 128 * sizeof(int));
+    }
+
+    const ctm::allocation_stats after = ctm::get_allocation_stats();
+    EXPECT_EQ(after.deallocations - before.deallocations, 8);
+    EXPECT_EQ(after.live_bytes, before.live_bytes);
+}
+#endif
+
+TEST(ReallocTrace, ChromeTraceRecorder)
+{
+    std::ostringstream os;
+
+    {
+        ctm::chrome_trace_recorder recorder;
+        ctm::detail::report_realloc(ctm::realloc_event{
+            nullptr, "warm\"up", 4, 8, 4, 16,
+            std::chrono::steady_clock::now(), std::chrono::nanoseconds(1500)});
+        EXPECT_EQ(recorder.size(), 1);
+        recorder.write(os);
+    }
+
+    const std::string json = os.str();
+    EXPECT_NE(json.find("\"traceEvents\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"warm\\\"up\""), std::string::npos);
+    EXPECT_NE(json.find("\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(json.find("\"new_capacity\":8"), std::string::npos);
+    EXPECT_NE(json.find("\"dur\":1.5"), std::string::npos);
+    EXPECT_FALSE(ctm::detail::realloc_tracing_active());
+}
+
+#if defined(CTM_VECTOR_TRACING)
+TEST(ReallocTrace, VectorReserve)
+{
+    ctm::chrome_trace_recorder recorder;
+    ctm::vector<int> vec;
+    vec.set_trace_tag("sessions");
+
+    for (int i = 0; i < 100; ++i)
+    {
+        vec.push_back(i);
+    }
+
+    EXPECT_EQ(recorder.size(), 8);
+
+    std::ostringstream os;
+    recorder.write(os);
+    EXPECT_NE(os.str().find("\"name\":\"sessions\""), std::string::npos);
+    EXPECT_NE(os.str().find("\"old_capacity\":64,\"new_capacity\":128,\"elements_moved\":64"), std::string::npos);
+}
+#endif
+
+namespace
+{
+
+// squares of the first N odd numbers, built with a transient ctm::vector
+template <std::size_t N>
+constexpr std::array<int, N> odd_squares()
+{
+    ctm::vector<int> vec;
+
+    for (int i = 0; vec.size() < N; ++i)
+    {
+        if (i % 2 == 1)
+        {
+            vec.push_back(i * i);
+        }
+    }
+
+    vec.insert(vec.begin(), 0);
+    vec.erase(vec.begin());
+
+    std::array<int, N> table{};
+    std::copy(vec.begin(), vec.end(), table.begin());
+    return table;
+}
+
+constexpr std::size_t constexpr_copy_and_resize()
+{
+    ctm::vector<int> vec{1, 2, 3};
+    ctm::vector<int> copy = vec;
+    copy.resize(10, 7);
+    copy.pop_back();
+    return copy.size() + static_cast<std::size_t>(copy[8]) + static_cast<std::size_t>(vec.back());
+}
+
+constexpr int constexpr_append_n()
+{
+    ctm::vector<int> vec;
+    int next = 0;
+    vec.append_n(5, [&next]() { return next++; });
+    vec.emplace_back_n(2, 10);
+    return vec[4] + vec[6] + static_cast<int>(vec.size());
+}
+
+};
+
+TEST(Constexpr, CompileTimeTable)
+{
+    constexpr std::array<int, 5> table = odd_squares<5>();
+    static_assert(table[0] == 1 && table[4] == 81);
+    static_assert(constexpr_copy_and_resize() == 9 + 7 + 3);
+    static_assert(constexpr_append_n() == 4 + 10 + 7);
+
+    EXPECT_EQ(table[2], 25);
+}
+
+TEST(EraseIf, Default)
+{
+    ctm::vector<int> vec;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        vec.push_back(i);
+    }
+
+    const std::size_t removed = ctm::erase_if(vec, [](int x) { return x % 3 == 0; });
+    EXPECT_EQ(removed, 34);
+    EXPECT_EQ(vec.size(), 66);
+    EXPECT_EQ(vec.capacity(), 128);
+
+    for (std::size_t i = 0; i < vec.size(); ++i)
+    {
+        EXPECT_NE(vec[i] % 3, 0);
+    }
+    EXPECT_EQ(vec.front(), 1);
+    EXPECT_EQ(vec.back(), 98);
+
+    EXPECT_EQ(ctm::erase_if(vec, [](int x) { return x > 1000; }), 0);
+    EXPECT_EQ(vec.size(), 66);
+
+    ctm::vector<S> vec2{S{1, 2.0, "a"}, S{2, 4.0, "b"}, S{3, 6.0, "c"}, S{4, 8.0, "d"}};
+    EXPECT_EQ(ctm::erase_if(vec2, [](const S& s) { return s.a() % 2 == 1; }), 2);
+    EXPECT_EQ(vec2.size(), 2);
+    EXPECT_EQ(vec2[0].c(), "b");
+    EXPECT_EQ(vec2[1].c(), "d");
+}
+
+TEST(EraseValue, Arithmetic)
+{
+    ctm::vector<int> ints;
+    ctm::vector<std::int64_t> longs;
+    ctm::vector<float> floats;
+    ctm::vector<double> doubles;
+
+    for (int i = 0; i < 101; ++i)
+    {
+        ints.push_back(i % 4);
+        longs.push_back(i % 4);
+        floats.push_back(static_cast<float>(i % 4));
+        doubles.push_back(i % 4);
+    }
+
+    EXPECT_EQ(ctm::erase(ints, 2), 25);
+    EXPECT_EQ(ctm::erase(longs, std::int64_t(2)), 25);
+    EXPECT_EQ(ctm::erase(floats, 2.0f), 25);
+    EXPECT_EQ(ctm::erase(doubles, 2.0), 25);
+    EXPECT_EQ(ctm::erase(ints, 7), 0);
+
+    const int expected[] = {0, 1, 3};
+
+    for (std::size_t i = 0; i < ints.size(); ++i)
+    {
+        EXPECT_EQ(ints[i], expected[i % 3]);
+        EXPECT_EQ(longs[i], expected[i % 3]);
+        EXPECT_EQ(floats[i], expected[i % 3]);
+        EXPECT_EQ(doubles[i], expected[i % 3]);
+    }
+    EXPECT_EQ(ints.size(), 76);
+
+    ctm::vector<std::string> strings{"a", "b", "a", "c"};
+    EXPECT_EQ(ctm::erase(strings, std::string("a")), 2);
+    EXPECT_EQ(strings.size(), 2);
+    EXPECT_EQ(strings[0], "b");
+}
+
+TEST(EraseUnordered, Iterator)
+{
+    ctm::vector<int> vec{{1,2,3,4,5}};
+
+    auto it = vec.erase_unordered(vec.begin() + 1);
+    EXPECT_EQ(*it, 5);
+    EXPECT_EQ(vec.size(), 4);
+    EXPECT_EQ(vec.capacity(), 8);
+    EXPECT_EQ(vec[0], 1);
+    EXPECT_EQ(vec[1], 5);
+    EXPECT_EQ(vec[2], 3);
+    EXPECT_EQ(vec[3], 4);
+
+    it = vec.erase_unordered(vec.end() - 1);
+    EXPECT_EQ(it, vec.end());
+    EXPECT_EQ(vec.size(), 3);
+
+    ctm::vector<S> vec2{S{1, 2.0, "a"}, S{2, 4.0, "b"}, S{3, 6.0, "c"}};
+    vec2.erase_unordered(vec2.begin());
+    EXPECT_EQ(vec2.size(), 2);
+    EXPECT_EQ(vec2[0].c(), "c");
+    EXPECT_EQ(vec2[1].c(), "b");
+}
+
+TEST(EraseUnordered, Predicate)
+{
+    ctm::vector<int> vec;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        vec.push_back(i);
+    }
+
+    EXPECT_EQ(vec.erase_unordered_if([](int x) { return x % 4 == 0; }), 25);
+    EXPECT_EQ(vec.size(), 75);
+
+    int sum = 0;
+
+    for (int x : vec)
+    {
+        EXPECT_NE(x % 4, 0);
+        sum += x;
+    }
+    EXPECT_EQ(sum, 4950 - 1200);
+
+    EXPECT_EQ(vec.erase_unordered_if([](int) { return true; }), 75);
+    EXPECT_TRUE(vec.empty());
+    EXPECT_EQ(vec.erase_unordered_if([](int) { return true; }), 0);
+
+    ctm::vector<std::string> strings{"keep", "drop", "drop", "keep", "drop"};
+    EXPECT_EQ(strings.erase_unordered_if([](const std::string& s) { return s == "drop"; }), 3);
+    EXPECT_EQ(strings.size(), 2);
+    EXPECT_EQ(strings[0], "keep");
+    EXPECT_EQ(strings[1], "keep");
+}
+
+TEST(FlatSet, InsertAndLookup)
+{
+    ctm::flat_set<int> set{5, 1, 3, 1, 9};
+    EXPECT_EQ(set.size(), 4);
+    EXPECT_TRUE(set.contains(3));
+    EXPECT_FALSE(set.contains(4));
+    EXPECT_EQ(*set.lower_bound(4), 5);
+    EXPECT_EQ(*set.upper_bound(5), 9);
+    EXPECT_EQ(set.upper_bound(9), set.end());
+    EXPECT_EQ(set.lower_bound(0), set.begin());
+
+    EXPECT_TRUE(set.insert(4).second);
+    EXPECT_FALSE(set.insert(4).second);
+
+    std::initializer_list<int> batch = {8, 2, 4, 7, 2};
+    set.insert(batch.begin(), batch.end());
+
+    const int expected[] = {1, 2, 3, 4, 5, 7, 8, 9};
+    EXPECT_EQ(set.size(), 8);
+
+    for (std::size_t i = 0; i < set.size(); ++i)
+    {
+        EXPECT_EQ(set.begin()[i], expected[i]);
+    }
+
+    EXPECT_EQ(set.erase(3), 1);
+    EXPECT_EQ(set.erase(3), 0);
+    EXPECT_EQ(set.size(), 7);
+}
+
+TEST(FlatSet, AdoptSorted)
+{
+    ctm::vector<int> sorted{{1, 4, 9, 16}};
+    const int* storage = sorted.data();
+    ctm::flat_set<int> set(ctm::sorted_unique, std::move(sorted));
+
+    EXPECT_EQ(set.size(), 4);
+    EXPECT_EQ(set.keys().data(), storage);
+    EXPECT_TRUE(set.contains(9));
+
+    ctm::flat_set<int, std::greater<int>> descending{1, 3, 2};
+    EXPECT_EQ(*descending.begin(), 3);
+    EXPECT_EQ(*descending.lower_bound(2), 2);
+}
+
+TEST(FlatMap, InsertAndLookup)
+{
+    ctm::flat_map<int, std::string> map;
+    EXPECT_TRUE(map.insert({3, "c"}).second);
+    EXPECT_TRUE(map.insert({1, "a"}).second);
+    EXPECT_FALSE(map.insert({1, "z"}).second);
+    map[2] = "b";
+    map.insert_or_assign(3, "C");
+
+    EXPECT_EQ(map.size(), 3);
+    EXPECT_EQ(map.at(1), "a");
+    EXPECT_EQ(map.at(2), "b");
+    EXPECT_EQ(map.at(3), "C");
+    EXPECT_EQ(map.find(4), map.end());
+    EXPECT_EQ(map.find(2)->second, "b");
+    EXPECT_EQ(map.lower_bound(2).key(), 2);
+    EXPECT_EQ(map.upper_bound(2).key(), 3);
+
+    EXPECT_THROW([&map](){
+        map.at(7);
+    }(), std::out_of_range);
+
+    std::pair<int, std::string> batch[] = {{5, "e"}, {0, "zero"}, {2, "dup"}, {4, "d"}, {5, "dup"}};
+    map.insert(std::begin(batch), std::end(batch));
+
+    EXPECT_EQ(map.size(), 6);
+    int previous = -1;
+
+    for (auto [key, value] : map)
+    {
+        EXPECT_LT(previous, key);
+        previous = key;
+    }
+
+    EXPECT_EQ(map.at(0), "zero");
+    EXPECT_EQ(map.at(2), "b");
+    EXPECT_EQ(map.at(5), "e");
+}
+
+TEST(FlatMap, AdoptAndErase)
+{
+    ctm::vector<int> keys{{10, 20, 30}};
+    ctm::vector<double> values{{1.0, 2.0, 3.0}};
+    ctm::flat_map<int, double> map(ctm::sorted_unique, std::move(keys), std::move(values));
+
+    EXPECT_EQ(map.size(), 3);
+    EXPECT_EQ(map.at(20), 2.0);
+
+    EXPECT_EQ(map.erase(20), 1);
+    EXPECT_EQ(map.erase(20), 0);
+    EXPECT_EQ(map.size(), 2);
+    EXPECT_EQ(map.keys()[1], 30);
+    EXPECT_EQ(map.values()[1], 3.0);
+
+    const ctm::flat_map<int, double>& cmap = map;
+    EXPECT_EQ(cmap.find(30).value(), 3.0);
+    EXPECT_EQ(cmap.end() - cmap.begin(), 2);
+}
+
+TEST(SearchIndex, MatchesStdBounds)
+{
+    for (int n : {0, 1, 2, 7, 8, 100, 1000})
+    {
+        ctm::vector<int> sorted;
+
+        for (int i = 0; i < n; ++i)
+        {
+            sorted.push_back(2 * (i / 3));
+        }
+
+        ctm::search_index<int> index(sorted);
+        EXPECT_EQ(index.size(), static_cast<std::size_t>(n));
+
+        ctm::vector<int> keys;
+
+        for (int key = -1; key <= 2 * n / 3 + 2; ++key)
+        {
+            keys.push_back(key);
+            const auto expected_lower = std::lower_bound(sorted.begin(), sorted.end(), key) - sorted.begin();
+            const auto expected_upper = std::upper_bound(sorted.begin(), sorted.end(), key) - sorted.begin();
+            EXPECT_EQ(index.lower_bound(key), expected_lower);
+            EXPECT_EQ(index.upper_bound(key), expected_upper);
+        }
+
+        ctm::vector<std::size_t> lower = index.lower_bound(keys);
+        ctm::vector<std::size_t> upper(keys.size());
+        index.upper_bound(keys.data(), keys.size(), upper.data());
+
+        for (std::size_t i = 0; i < keys.size(); ++i)
+        {
+            EXPECT_EQ(lower[i], index.lower_bound(keys[i]));
+            EXPECT_EQ(upper[i], index.upper_bound(keys[i]));
+        }
+    }
+}
+
+TEST(SearchIndex, CustomCompare)
+{
+    ctm::vector<int> sorted{{9, 7, 7, 3, 1}};
+    ctm::search_index<int, std::greater<int>> index(sorted);
+
+    EXPECT_EQ(index.lower_bound(7), 1);
+    EXPECT_EQ(index.upper_bound(7), 3);
+    EXPECT_EQ(index.lower_bound(0), 5);
+    EXPECT_EQ(index.lower_bound(10), 0);
+}
+
+TEST(SearchIndex, MatchesStdBoundsForEverySize)
+{
+    // ranks are computed from node indices, so cover full and partial
+    // bottom levels
+    for (int n = 0; n <= 130; ++n)
+    {
+        ctm::vector<int> sorted;
+
+        for (int i = 0; i < n; ++i)
+        {
+            sorted.push_back(2 * (i / 2));
+        }
+
+        ctm::search_index<int> index(sorted);
+
+        for (int key = -1; key <= n + 1; ++key)
+        {
+            const auto lower = std::lower_bound(sorted.begin(), sorted.end(), key) - sorted.begin();
+            const auto upper = std::upper_bound(sorted.begin(), sorted.end(), key) - sorted.begin();
+            EXPECT_EQ(index.lower_bound(key), static_cast<std::size_t>(lower));
+            EXPECT_EQ(index.upper_bound(key), static_cast<std::size_t>(upper));
+        }
+    }
+}
+
+TEST(Insert, NonTrivialShift)
+{
+    ctm::vector<std::string> vec{"a", "b", "c"};
+    vec.reserve(8);
+
+    vec.insert(vec.begin() + 1, 3, std::string("x"));
+    EXPECT_EQ(vec.size(), 6);
+    EXPECT_EQ(vec.capacity(), 8);
+
+    const char* expected[] = {"a", "x", "x", "x", "b", "c"};
+
+    for (std::size_t i = 0; i < vec.size(); ++i)
+    {
+        EXPECT_EQ(vec[i], expected[i]);
+    }
+
+    // grows and shifts in one pass
+    std::initializer_list<std::string> more = {"p", "q", "r"};
+    vec.insert(vec.begin() + 2, more.begin(), more.end());
+    EXPECT_EQ(vec.size(), 9);
+    EXPECT_EQ(vec.capacity(), 16);
+
+    const char* expected2[] = {"a", "x", "p", "q", "r", "x", "x", "b", "c"};
+
+    for (std::size_t i = 0; i < vec.size(); ++i)
+    {
+        EXPECT_EQ(vec[i], expected2[i]);
+    }
+
+    // the inserted value refers to an element that moves
+    vec.insert(vec.begin(), vec[8]);
+    EXPECT_EQ(vec[0], "c");
+    EXPECT_EQ(vec[9], "c");
+
+    EXPECT_THROW([&vec](){
+        vec.insert(vec.end() + 1, std::string("z"));
+    }(), std::out_of_range);
+}
+
+TEST(Insert, InputIteratorSource)
+{
+    std::istringstream is("7 8 9");
+    ctm::vector<int> vec{{1, 2, 3}};
+    auto it = vec.insert(vec.begin() + 1, std::istream_iterator<int>(is), std::istream_iterator<int>());
+
+    EXPECT_EQ(*it, 7);
+    EXPECT_EQ(vec.size(), 6);
+
+    const int expected[] = {1, 7, 8, 9, 2, 3};
+
+    for (std::size_t i = 0; i < vec.size(); ++i)
+    {
+        EXPECT_EQ(vec[i], expected[i]);
+    }
+}
+
+namespace
+{
+
+// Copying throws once copies_left runs out; the long string lives on the
+// heap, so ASan reports any element that is leaked or destroyed twice.
+struct throwing_copy
+{
+    static int copies_left;
+    std::string text;
+
+    explicit throwing_copy(const char* t):
+        text(std::string(32, '.') + t) {}
+
+    throwing_copy(const throwing_copy& other):
+        text(other.text)
+    {
+        if (copies_left-- == 0)
+        {
+            throw std::runtime_error("copy failed");
+        }
+    }
+
+    throwing_copy(throwing_copy&&) = default;
+    throwing_copy& operator=(const throwing_copy&) = default;
+    throwing_copy& operator=(throwing_copy&&) = default;
+};
+
+int throwing_copy::copies_left = 0;
+
+void expect_texts(const ctm::vector<throwing_copy>& vec, std::initializer_list<const char*> expected)
+{
+    ASSERT_EQ(vec.size(), expected.size());
+    std::size_t i = 0;
+
+    for (const char* text : expected)
+    {
+        EXPECT_EQ(vec[i++].text, std::string(32, '.') + text);
+    }
+}
+
+};
+
+TEST(Insert, ThrowingCopyKeepsElements)
+{
+    ctm::vector<throwing_copy> vec;
+    vec.reserve(8);
+    vec.emplace_back("a");
+    vec.emplace_back("b");
+    vec.emplace_back("c");
+    const throwing_copy x("x");
+
+    // in place: the tail has shifted when the third copy throws
+    throwing_copy::copies_left = 3;
+    EXPECT_THROW([&](){vec.insert(vec.begin() + 1, 3, x);}(), std::runtime_error);
+    expect_texts(vec, {"a", "b", "c"});
+
+    const throwing_copy source[] = {throwing_copy("p"), throwing_copy("q"), throwing_copy("r")};
+    throwing_copy::copies_left = 2;
+    EXPECT_THROW([&](){vec.insert(vec.begin(), std::begin(source), std::end(source));}(),
+                 std::runtime_error);
+    expect_texts(vec, {"a", "b", "c"});
+
+    // growing: the gap is in the new buffer
+    vec.emplace_back("d");
+    vec.emplace_back("e");
+    throwing_copy::copies_left = 4;
+    EXPECT_THROW([&](){vec.insert(vec.begin() + 2, 5, x);}(), std::runtime_error);
+    expect_texts(vec, {"a", "b", "c", "d", "e"});
+
+    throwing_copy::copies_left = 100;
+    vec.insert(vec.begin() + 1, 2, x);
+    expect_texts(vec, {"a", "x", "x", "b", "c", "d", "e"});
+}
+
+TEST(Erase, NonTrivialShift)
+{
+    ctm::vector<std::string> vec{"a", "b", "c", "d", "e", "f"};
+
+    auto it = vec.erase(vec.begin() + 1);
+    EXPECT_EQ(*it, "c");
+    EXPECT_EQ(vec.size(), 5);
+
+    it = vec.erase(vec.begin() + 1, vec.begin() + 3);
+    EXPECT_EQ(*it, "e");
+    EXPECT_EQ(vec.size(), 3);
+    EXPECT_EQ(vec[0], "a");
+    EXPECT_EQ(vec[1], "e");
+    EXPECT_EQ(vec[2], "f");
+
+    it = vec.erase(vec.begin() + 1, vec.end());
+    EXPECT_EQ(it, vec.end());
+    EXPECT_EQ(vec.size(), 1);
+
+    ctm::vector<int> ints{{1, 2, 3, 4}};
+    EXPECT_EQ(*ints.erase(ints.begin()), 2);
+    EXPECT_EQ(ints.erase(ints.begin(), ints.begin()), ints.begin());
+    EXPECT_EQ(ints.size(), 3);
+}
+
+TEST(ShrinkToFit, Default)
+{
+    ctm::vector<int> vec;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        vec.push_back(i);
+    }
+
+    EXPECT_EQ(vec.capacity(), 128);
+    vec.erase(vec.begin() + 10, vec.end());
+
+    vec.shrink_to(64);
+    EXPECT_EQ(vec.capacity(), 64);
+    vec.shrink_to(1);
+    EXPECT_EQ(vec.capacity(), 10);
+    vec.shrink_to(100);
+    EXPECT_EQ(vec.capacity(), 10);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        EXPECT_EQ(vec[i], i);
+    }
+
+    vec.clear();
+    vec.shrink_to_fit();
+    EXPECT_EQ(vec.capacity(), 0);
+    EXPECT_EQ(vec.data(), nullptr);
+
+    ctm::vector<S> vec2{S{1, 2.0, "a"}, S{2, 4.0, "b"}, S{3, 6.0, "c"}};
+    vec2.shrink_to_fit();
+    EXPECT_EQ(vec2.capacity(), 3);
+    EXPECT_EQ(vec2[2].c(), "c");
+
+    vec2.release_memory();
+    EXPECT_EQ(vec2.size(), 0);
+    EXPECT_EQ(vec2.capacity(), 0);
+    vec2.push_back(S{4, 8.0, "d"});
+    EXPECT_EQ(vec2.capacity(), 1);
+}
+
+TEST(TrimAll, RegisteredContainers)
+{
+    ctm::vector<int> a;
+    ctm::vector<double> b;
+    a.reserve(1000);
+    b.reserve(100);
+    a.push_back(1);
+
+    EXPECT_EQ(ctm::trim_all(), 0);
+
+    {
+        ctm::trim_registration ra = ctm::register_for_trim(a);
+        ctm::trim_registration rb = ctm::register_for_trim(b);
+
+        EXPECT_EQ(ctm::trim_all(), 999 * sizeof(int) + 100 * sizeof(double));
+        EXPECT_EQ(a.capacity(), 1);
+        EXPECT_EQ(b.capacity(), 0);
+        EXPECT_EQ(a[0], 1);
+    }
+
+    a.reserve(1000);
+    EXPECT_EQ(ctm::trim_all(), 0);
+    EXPECT_EQ(a.capacity(), 1000);
+}
+
+TEST(RecyclingAllocator, ReusesFreedBuffer)
+{
+    ctm::buffer_recycler::release();
+    const int* first_buffer;
+
+    {
+        ctm::recycling_vector<int> vec;
+        vec.reserve(1000);
+        vec.push_back(1);
+        first_buffer = vec.data();
+    }
+
+    EXPECT_EQ(ctm::buffer_recycler::thread_cached_bytes(), 1024 * sizeof(int));
+
+    ctm::recycling_vector<int> vec2;
+    vec2.reserve(1000);
+    EXPECT_EQ(vec2.data(), first_buffer);
+    EXPECT_EQ(ctm::buffer_recycler::thread_cached_bytes(), 0);
+
+    // a different size class is served by a fresh buffer
+    ctm::recycling_vector<int> vec3;
+    vec3.reserve(10);
+    EXPECT_NE(vec3.data(), first_buffer);
+}
+
+TEST(RecyclingAllocator, SharedAcrossThreads)
+{
+    ctm::buffer_recycler::release();
+    const double* buffer = nullptr;
+
+    std::thread producer([&buffer]()
+    {
+        ctm::recycling_vector<double> vec(512, 1.0);
+        buffer = vec.data();
+    });
+    producer.join();
+
+    // the exiting thread handed its cache to the shared tier
+    EXPECT_EQ(ctm::buffer_recycler::global_cached_bytes(), 512 * sizeof(double));
+
+    ctm::recycling_vector<double> vec(512, 2.0);
+    EXPECT_EQ(vec.data(), buffer);
+    EXPECT_EQ(vec[511], 2.0);
+    EXPECT_EQ(ctm::buffer_recycler::global_cached_bytes(), 0);
+}
+
+TEST(RecyclingAllocator, ByteCap)
+{
+    ctm::buffer_recycler::release();
+    ctm::buffer_recycler::set_limits(4096, 0);
+
+    {
+        ctm::recycling_vector<char> small(100, 'a');
+        ctm::recycling_vector<char> large(8000, 'b');
+    }
+
+    EXPECT_EQ(ctm::buffer_recycler::thread_cached_bytes(), 128);
+    EXPECT_EQ(ctm::buffer_recycler::global_cached_bytes(), 0);
+    EXPECT_EQ(ctm::buffer_recycler::release(), 128);
+
+    ctm::buffer_recycler::set_limits(16 * 1024 * 1024, 256 * 1024 * 1024);
+}
+
+TEST(PmrVector, UsesMemoryResource)
+{
+    std::array<std::byte, 4096> buffer;
+    std::pmr::monotonic_buffer_resource pool(buffer.data(), buffer.size(),
+                                             std::pmr::null_memory_resource());
+    ctm::pmr::vector<int> vec(&pool);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        vec.push_back(i);
+    }
+
+    EXPECT_EQ(vec.get_allocator().resource(), &pool);
+    EXPECT_GE(reinterpret_cast<std::byte*>(vec.data()), buffer.data());
+    EXPECT_LT(reinterpret_cast<std::byte*>(vec.data()), buffer.data() + buffer.size());
+    EXPECT_EQ(vec[99], 99);
+
+    // the null upstream resource turns exhaustion into bad_alloc
+    EXPECT_THROW([&vec](){vec.reserve(4096);}(), std::bad_alloc);
+}
+
+TEST(PmrVector, AllocatorDoesNotPropagate)
+{
+    std::pmr::unsynchronized_pool_resource pool_a;
+    std::pmr::unsynchronized_pool_resource pool_b;
+    ctm::pmr::vector<int> a({1, 2, 3}, &pool_a);
+    ctm::pmr::vector<int> b({4, 5}, &pool_b);
+
+    // copies select the default resource, moves keep the source's
+    ctm::pmr::vector<int> copy(a);
+    EXPECT_EQ(copy.get_allocator().resource(), std::pmr::get_default_resource());
+    ctm::pmr::vector<int> moved(std::move(b));
+    EXPECT_EQ(moved.get_allocator().resource(), &pool_b);
+
+    // assignment keeps the target's resource
+    copy = a;
+    EXPECT_EQ(copy.get_allocator().resource(), std::pmr::get_default_resource());
+    a = std::move(moved);
+    EXPECT_EQ(a.get_allocator().resource(), &pool_a);
+    EXPECT_EQ(a.size(), 2);
+    EXPECT_EQ(a[1], 5);
+
+    // swap across resources moves the elements, not the allocators
+    a.swap(copy);
+    EXPECT_EQ(a.get_allocator().resource(), &pool_a);
+    EXPECT_EQ(copy.get_allocator().resource(), std::pmr::get_default_resource());
+    EXPECT_EQ(a.size(), 3);
+    EXPECT_EQ(a[2], 3);
+    EXPECT_EQ(copy.size(), 2);
+    EXPECT_EQ(copy[0], 4);
+}
+
+TEST(PmrVector, ElementsShareResource)
+{
+    std::pmr::unsynchronized_pool_resource pool;
+    ctm::pmr::vector<std::pmr::string> vec(&pool);
+    vec.push_back(std::pmr::string("a string long enough to need the heap"));
+    vec.emplace_back("another string long enough to need the heap");
+
+    EXPECT_EQ(vec[0].get_allocator().resource(), &pool);
+    EXPECT_EQ(vec[1].get_allocator().resource(), &pool);
+    EXPECT_EQ(vec[1], "another string long enough to need the heap");
+}
+
+TEST(CompactVector, Footprint)
+{
+    EXPECT_EQ(sizeof(ctm::compact_vector<std::uint32_t>), sizeof(void*));
+    EXPECT_EQ(sizeof(ctm::compact_vector<S>), sizeof(void*));
+
+    ctm::compact_vector<std::uint32_t> vec;
+    EXPECT_EQ(vec.data(), nullptr);
+    EXPECT_EQ(vec.size(), 0);
+    EXPECT_EQ(vec.capacity(), 0);
+
+    for (std::uint32_t i = 0; i < 5; ++i)
+    {
+        vec.push_back(i * 3);
+    }
+
+    EXPECT_EQ(vec.size(), 5);
+    EXPECT_EQ(vec.capacity(), 8);
+    EXPECT_EQ(vec.back(), 12);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(vec.data()) % alignof(std::uint32_t), 0);
+
+    vec.shrink_to_fit();
+    EXPECT_EQ(vec.capacity(), 5);
+    EXPECT_EQ(vec[4], 12);
+    EXPECT_THROW([&vec](){vec.at(5);}(), std::out_of_range);
+}
+
+TEST(CompactVector, AdjacencyList)
+{
+    ctm::vector<ctm::compact_vector<std::uint32_t>> adjacency(4);
+    adjacency[0].push_back(1);
+    adjacency[0].push_back(2);
+    adjacency[2].push_back(3);
+    adjacency[3] = {0, 1, 2};
+
+    EXPECT_EQ(adjacency[0].size(), 2);
+    EXPECT_TRUE(adjacency[1].empty());
+    EXPECT_EQ(adjacency[2].front(), 3);
+    EXPECT_EQ(adjacency[3], (ctm::compact_vector<std::uint32_t>{0, 1, 2}));
+}
+
+TEST(CompactVector, NonTrivialElements)
+{
+    ctm::compact_vector<std::string> vec{"a", "b", "c"};
+    vec.emplace_back(40, 'd');
+    vec.push_back(vec[0]);
+
+    ctm::compact_vector<std::string> copy(vec);
+    ctm::compact_vector<std::string> moved(std::move(vec));
+    EXPECT_TRUE(vec.empty());
+    EXPECT_EQ(copy, moved);
+    EXPECT_EQ(moved.size(), 5);
+    EXPECT_EQ(moved[3], std::string(40, 'd'));
+    EXPECT_EQ(moved[4], "a");
+
+    moved.erase(moved.begin() + 1);
+    EXPECT_EQ(moved[1], "c");
+    moved.resize(2);
+    EXPECT_EQ(moved.size(), 2);
+    moved.resize(3, "e");
+    EXPECT_EQ(moved.back(), "e");
+}
+
+namespace
+{
+
+// Forwards to the default resource and tracks the bytes it has handed out,
+// so a block freed through the wrong resource shows up as an imbalance.
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+    long outstanding = 0;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        outstanding += static_cast<long>(bytes);
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+        outstanding -= static_cast<long>(bytes);
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+struct throwing_move
+{
+    static int moves_left;
+    std::string text;
+
+    explicit throwing_move(const char* t):
+        text(std::string(32, '.') + t) {}
+
+    throwing_move(const throwing_move&) = default;
+
+    throwing_move(throwing_move&& other):
+        text(std::move(other.text))
+    {
+        if (moves_left-- == 0)
+        {
+            throw std::runtime_error("move failed");
+        }
+    }
+
+    throwing_move& operator=(const throwing_move&) = default;
+    throwing_move& operator=(throwing_move&&) = default;
+};
+
+int throwing_move::moves_left = 1000;
+
+};
+
+TEST(CompactVector, StatefulAllocator)
+{
+    using pmr_compact = ctm::compact_vector<std::string, std::pmr::polymorphic_allocator<std::string>>;
+    counting_resource first;
+    counting_resource second;
+
+    {
+        pmr_compact a(&first);
+        pmr_compact b(&second);
+        a.push_back(std::string(40, 'a'));
+        a.push_back(std::string(40, 'b'));
+        b.push_back(std::string(40, 'c'));
+
+        // pmr allocators do not propagate: b keeps its resource and the
+        // elements move across
+        b = std::move(a);
+        EXPECT_EQ(b.size(), 2);
+        EXPECT_EQ(b[1], std::string(40, 'b'));
+
+        // copies select the default resource
+        const long before = first.outstanding + second.outstanding;
+        pmr_compact copy(b);
+        EXPECT_EQ(first.outstanding + second.outstanding, before);
+        EXPECT_EQ(copy, b);
+
+        pmr_compact assigned(&first);
+        assigned = b;
+        EXPECT_EQ(assigned, b);
+    }
+
+    EXPECT_EQ(first.outstanding, 0);
+    EXPECT_EQ(second.outstanding, 0);
+}
+
+TEST(CompactVector, ThrowingMoveDuringGrowth)
+{
+    counting_resource resource;
+
+    {
+        ctm::compact_vector<throwing_move, std::pmr::polymorphic_allocator<throwing_move>> vec(&resource);
+        vec.reserve(3);
+        vec.emplace_back("a");
+        vec.emplace_back("b");
+        vec.emplace_back("c");
+        const long held = resource.outstanding;
+
+        throwing_move::moves_left = 1;
+        const throwing_move d("d");
+        EXPECT_THROW([&](){vec.push_back(d);}(), std::runtime_error);
+        throwing_move::moves_left = 1000;
+
+        EXPECT_EQ(resource.outstanding, held);
+        EXPECT_EQ(vec.size(), 3);
+        EXPECT_EQ(vec.capacity(), 3);
+        EXPECT_EQ(vec[2].text, std::string(32, '.') + "c");
+    }
+
+    EXPECT_EQ(resource.outstanding, 0);
+}
+
+TEST(FlatMap, ThrowingMoveKeepsEntries)
+{
+    const std::string b(32, 'b');
+    const std::string d(32, 'd');
+    ctm::flat_map<std::string, throwing_move> map;
+    map.try_emplace(b, "b");
+    map.try_emplace(d, "d");
+
+    const std::pair<std::string, throwing_move> batch[] = {
+        {std::string(32, 'e'), throwing_move("e")},
+        {std::string(32, 'a'), throwing_move("a")},
+        {std::string(32, 'c'), throwing_move("c")}};
+
+    // fail at every move in turn: the map is either unchanged or complete
+    for (int fail_at = 0; map.size() == 2; ++fail_at)
+    {
+        throwing_move::moves_left = fail_at;
+
+        try
+        {
+            map.insert(std::begin(batch), std::end(batch));
+        }
+        catch (const std::runtime_error&)
+        {
+            ASSERT_EQ(map.size(), 2);
+            EXPECT_EQ(map.keys()[0], b);
+            EXPECT_EQ(map.keys()[1], d);
+            EXPECT_EQ(map.values()[1].text, std::string(32, '.') + "d");
+        }
+    }
+
+    EXPECT_EQ(map.size(), 5);
+    EXPECT_EQ(map.at(std::string(32, 'c')).text, std::string(32, '.') + "c");
+
+    // a failed single insert does not leave its key behind
+    throwing_move::moves_left = 0;
+    EXPECT_THROW([&](){map.try_emplace(std::string(32, 'f'), "f");}(), std::runtime_error);
+    throwing_move::moves_left = 1000;
+
+    EXPECT_EQ(map.size(), 5);
+    EXPECT_EQ(map.keys().size(), map.values().size());
+    EXPECT_FALSE(map.contains(std::string(32, 'f')));
+}
+
+TEST(FlatSet, ThrowingMoveKeepsKeys)
+{
+    auto by_text = [](const throwing_move& x, const throwing_move& y) { return x.text < y.text; };
+    ctm::flat_set<throwing_move, decltype(by_text)> set(by_text);
+    set.insert(throwing_move("b"));
+    set.insert(throwing_move("d"));
+
+    const throwing_move batch[] = {throwing_move("e"), throwing_move("a"), throwing_move("c")};
+
+    for (int fail_at = 0; set.size() == 2; ++fail_at)
+    {
+        throwing_move::moves_left = fail_at;
+
+        try
+        {
+            set.insert(std::begin(batch), std::end(batch));
+        }
+        catch (const std::runtime_error&)
+        {
+            ASSERT_EQ(set.size(), 2);
+            EXPECT_EQ(set.begin()->text, std::string(32, '.') + "b");
+            EXPECT_EQ(std::next(set.begin())->text, std::string(32, '.') + "d");
+        }
+    }
+
+    throwing_move::moves_left = 1000;
+    EXPECT_EQ(set.size(), 5);
+}
+
+TEST(JaggedVector, AppendRows)
+{
+    ctm::jagged_vector<int> jag;
+    EXPECT_TRUE(jag.empty());
+
+    ctm::vector<int> first{1, 2, 3};
+    jag.append_row(first);
+    jag.append_row({});
+    jag.append_row(std::views::iota(10, 14));
+    jag.append_row(2, 7);
+
+    EXPECT_EQ(jag.rows(), 4);
+    EXPECT_EQ(jag.value_count(), 9);
+    EXPECT_EQ(jag.row_size(0), 3);
+    EXPECT_TRUE(jag[1].empty());
+    EXPECT_EQ(jag[2][3], 13);
+    EXPECT_EQ(jag.back()[1], 7);
+    EXPECT_THROW([&jag](){jag.at(4);}(), std::out_of_range);
+
+    // rows are views into one contiguous buffer
+    EXPECT_EQ(jag[2].data(), jag.values().data() + 3);
+    jag[0][1] = 20;
+    EXPECT_EQ(jag.values()[1], 20);
+
+    int sum = 0;
+    for (std::span<int> row : jag)
+    {
+        for (int x : row)
+        {
+            sum += x;
+        }
+    }
+    EXPECT_EQ(sum, 1 + 20 + 3 + 10 + 11 + 12 + 13 + 7 + 7);
+
+    jag.pop_row();
+    EXPECT_EQ(jag.rows(), 3);
+    EXPECT_EQ(jag.value_count(), 7);
+}
+
+TEST(JaggedVector, AppendRowGrowsGeometrically)
+{
+    ctm::jagged_vector<int> rows;
+    const std::array<int, 8> row{1, 2, 3, 4, 5, 6, 7, 8};
+    std::size_t reallocations = 0;
+    std::size_t capacity = rows.values().capacity();
+
+    for (int i = 0; i < 20000; ++i)
+    {
+        if (i % 2 == 0)
+        {
+            rows.append_row(row);
+        }
+        else
+        {
+            rows.append_row({1, 2, 3, 4, 5, 6, 7, 8});
+        }
+
+        if (rows.values().capacity() != capacity)
+        {
+            capacity = rows.values().capacity();
+            ++reallocations;
+        }
+    }
+
+    EXPECT_EQ(rows.value_count(), 160000);
+    EXPECT_LE(reallocations, 20);
+    EXPECT_EQ(rows[19999][7], 8);
+}
+
+TEST(JaggedVector, NestedConversion)
+{
+    ctm::vector<ctm::vector<std::string>> nested;
+    nested.push_back(ctm::vector<std::string>{"a", "b"});
+    nested.push_back(ctm::vector<std::string>{});
+    nested.push_back(ctm::vector<std::string>{"c"});
+
+    ctm::jagged_vector<std::string> jag(nested);
+    EXPECT_EQ(jag.rows(), 3);
+    EXPECT_EQ(jag[0][1], "b");
+    EXPECT_EQ(jag[2][0], "c");
+
+    ctm::vector<ctm::vector<std::string>> back = jag.to_nested();
+    EXPECT_EQ(back.size(), 3);
+    EXPECT_EQ(back[0].size(), 2);
+    EXPECT_TRUE(back[1].empty());
+    EXPECT_EQ(back[2][0], "c");
+}
+
+TEST(JaggedVector, Builder)
+{
+    ctm::jagged_vector<int>::builder b(5);
+    b.add(3, 30);
+    b.add(0, 1);
+    b.add(3, 31);
+    b.add(1, 10);
+    b.add(0, 2);
+
+    ctm::jagged_vector<int> jag = b.build();
+    EXPECT_EQ(b.size(), 0);
+    EXPECT_EQ(jag, (ctm::jagged_vector<int>{{1, 2}, {10}, {}, {30, 31}, {}}));
+}
+
+TEST(RingVector, Queue)
+{
+    ctm::ring_vector<int> ring;
+
+    for (int i = 0; i < 6; ++i)
+    {
+        ring.push_back(i);
+    }
+
+    EXPECT_EQ(ring.capacity(), 8);
+    ring.pop_front();
+    ring.pop_front();
+    ring.push_back(6);
+    ring.push_back(7);
+    ring.push_back(8);
+    ring.push_back(9);
+
+    // full and wrapped: no growth and no shifting happened
+    EXPECT_EQ(ring.capacity(), 8);
+    EXPECT_EQ(ring.size(), 8);
+    EXPECT_EQ(ring.front(), 2);
+    EXPECT_EQ(ring.back(), 9);
+
+    auto [first, second] = ring.as_spans();
+    EXPECT_EQ(first.size(), 6);
+    EXPECT_EQ(second.size(), 2);
+    EXPECT_EQ(first[0], 2);
+    EXPECT_EQ(second[1], 9);
+
+    ring.push_front(1);
+    EXPECT_EQ(ring.capacity(), 16);
+    EXPECT_EQ(ring.size(), 9);
+    // growth unwrapped the buffer, then the new front wrapped to the last slot
+    EXPECT_EQ(ring.as_spans().first.size(), 1);
+    EXPECT_EQ(ring.as_spans().second.size(), 8);
+
+    ctm::vector<int> expected{1, 2, 3, 4, 5, 6, 7, 8, 9};
+    EXPECT_TRUE(std::equal(ring.begin(), ring.end(), expected.begin(), expected.end()));
+    EXPECT_THROW([&ring](){ring.at(9);}(), std::out_of_range);
+}
+
+TEST(RingVector, RandomAccessIterators)
+{
+    ctm::ring_vector<int> ring{5, 3, 8};
+    ring.push_front(9);
+    ring.push_front(1);
+
+    std::sort(ring.begin(), ring.end());
+    EXPECT_EQ(ring, (ctm::ring_vector<int>{1, 3, 5, 8, 9}));
+    EXPECT_EQ(ring.end() - ring.begin(), 5);
+    EXPECT_EQ(ring.begin()[2], 5);
+    EXPECT_EQ(*std::lower_bound(ring.cbegin(), ring.cend(), 6), 8);
+}
+
+TEST(RingVector, NonTrivialElements)
+{
+    ctm::ring_vector<std::string> ring;
+
+    for (int i = 0; i < 20; ++i)
+    {
+        ring.push_back(std::string(30, static_cast<char>('a' + i)));
+
+        if (i % 3 == 0)
+        {
+            ring.pop_front();
+        }
+    }
+
+    ctm::ring_vector<std::string> copy(ring);
+    ctm::ring_vector<std::string> moved(std::move(ring));
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(copy, moved);
+    EXPECT_EQ(moved.size(), 13);
+    EXPECT_EQ(moved.front(), std::string(30, 'h'));
+    EXPECT_EQ(moved.back(), std::string(30, 't'));
+}
+
+TEST(StreamingStores, FillAndCopy)
+{
+    const std::size_t saved = ctm::streaming_threshold();
+    ctm::set_streaming_threshold(ctm::streaming_always);
+
+    ctm::vector<int> filled(1003, 7);
+    EXPECT_EQ(std::count(filled.begin(), filled.end(), 7), 1003);
+
+    ctm::vector<int> copy(filled);
+    EXPECT_TRUE(std::equal(copy.begin(), copy.end(), filled.begin(), filled.end()));
+
+    // inserting into the middle streams into an unaligned gap
+    ctm::vector<char> bytes(5, 'a');
+    bytes.insert(bytes.begin() + 3, 77, 'b');
+    EXPECT_EQ(bytes.size(), 82);
+    EXPECT_EQ(std::count(bytes.begin() + 3, bytes.begin() + 80, 'b'), 77);
+    EXPECT_EQ(bytes[80], 'a');
+
+    ctm::vector<double> doubles{1.0, 2.0};
+    doubles.resize(301, 0.5);
+    EXPECT_EQ(doubles[1], 2.0);
+    EXPECT_EQ(doubles[300], 0.5);
+
+    ctm::vector<std::array<int, 3>> triples(50, std::array<int, 3>{1, 2, 3});
+    EXPECT_EQ(triples[49][2], 3);
+
+    ctm::set_streaming_threshold(saved);
+}
+
+#if defined(__linux__)
+namespace
+{
+
+long minor_faults()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+}
+
+// Minor faults taken while writing every element of a freshly reserved
+// vector; 64 MiB is above malloc's mmap threshold, so the pages are new.
+template <typename Reserve>
+long faults_writing_reserved(Reserve reserve)
+{
+    constexpr std::size_t count = std::size_t(16) << 20;
+    ctm::vector<int> vec;
+    reserve(vec, count);
+    const long before = minor_faults();
+    vec.insert(vec.end(), count, 1);
+    const long faults = minor_faults() - before;
+    EXPECT_EQ(vec[count - 1], 1);
+    return faults;
+}
+
+};
+
+TEST(Prefault, Reserve)
+{
+    const long plain = faults_writing_reserved([](ctm::vector<int>& vec, std::size_t n) { vec.reserve(n); });
+    const long prefaulted = faults_writing_reserved(
+        [](ctm::vector<int>& vec, std::size_t n) { vec.reserve(n, ctm::prefault); });
+    const long async = faults_writing_reserved(
+        [](ctm::vector<int>& vec, std::size_t n) { vec.reserve(n, ctm::prefault_async).get(); });
+
+    EXPECT_LT(prefaulted, plain);
+    EXPECT_LE(async, prefaulted + plain / 2);
+}
+#endif
+
+TEST(Prefault, KeepsContents)
+{
+    ctm::vector<int> vec{1, 2, 3};
+    vec.reserve(5000, ctm::prefault);
+    EXPECT_EQ(vec.capacity(), 5000);
+    EXPECT_EQ(vec[2], 3);
+
+    std::future<void> warm = vec.reserve(20000, ctm::prefault_async);
+    vec.push_back(4);
+    warm.wait();
+    EXPECT_EQ(vec.size(), 4);
+    EXPECT_EQ(vec[3], 4);
+
+    ctm::vector<double, ctm::prefaulting_allocator<double>> prefaulted(1000, 2.5);
+    prefaulted.push_back(1.0);
+    EXPECT_EQ(prefaulted[999], 2.5);
+    EXPECT_EQ(prefaulted.back(), 1.0);
+}
+
+TEST(IncrementalVector, ReadsAcrossBuffers)
+{
+    ctm::incremental_vector<int> vec;
+
+    for (int i = 0; i < 64; ++i)
+    {
+        vec.push_back(i);
+    }
+
+    EXPECT_FALSE(vec.migrating());
+    EXPECT_EQ(vec.capacity(), 64);
+
+    // growth allocates the new buffer but moves only a few elements
+    vec.push_back(64);
+    EXPECT_TRUE(vec.migrating());
+    EXPECT_EQ(vec.capacity(), 128);
+
+    for (int i = 0; i < 65; ++i)
+    {
+        EXPECT_EQ(vec[i], i);
+    }
+
+    for (int i = 65; i < 70; ++i)
+    {
+        vec.push_back(i);
+    }
+    EXPECT_TRUE(std::equal(vec.begin(), vec.end(), std::views::iota(0, 70).begin()));
+
+    // 64 pending elements at 4 per push are done after 16 pushes
+    for (int i = 70; i < 81; ++i)
+    {
+        vec.push_back(i);
+    }
+    EXPECT_FALSE(vec.migrating());
+    EXPECT_EQ(vec.at(80), 80);
+    EXPECT_THROW([&vec](){vec.at(81);}(), std::out_of_range);
+}
+
+TEST(IncrementalVector, PopAndAliasDuringMigration)
+{
+    ctm::incremental_vector<std::string> vec;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        vec.push_back(std::string(20, static_cast<char>('a' + i)));
+    }
+
+    // the argument lives in the old buffer when growth starts
+    vec.push_back(vec[0]);
+    EXPECT_TRUE(vec.migrating());
+    EXPECT_EQ(vec.back(), std::string(20, 'a'));
+
+    for (int i = 0; i < 15; ++i)
+    {
+        vec.pop_back();
+    }
+
+    EXPECT_EQ(vec.size(), 2);
+    EXPECT_EQ(vec[1], std::string(20, 'b'));
+
+    ctm::incremental_vector<std::string> copy(vec);
+    EXPECT_EQ(copy, vec);
+    EXPECT_EQ(vec.data()[0], std::string(20, 'a'));
+    EXPECT_FALSE(vec.migrating());
+
+    vec.clear();
+    EXPECT_TRUE(vec.empty());
+    vec.push_back("x");
+    EXPECT_EQ(vec.front(), "x");
+}
+
+static_assert(std::ranges::contiguous_range<ctm::vector<int>>);
+static_assert(std::ranges::sized_range<ctm::vector<int>>);
+static_assert(std::ranges::contiguous_range<const ctm::vector<int>>);
+
+TEST(Ranges, Construct)
+{
+    std::list<int> source{1, 2, 3, 4, 5};
+    ctm::vector<int> from_list(ctm::from_range, source);
+    EXPECT_EQ(from_list.size(), 5);
+    EXPECT_EQ(from_list.capacity(), 8);
+    EXPECT_EQ(from_list[4], 5);
+
+    ctm::vector<long> widened(ctm::from_range, from_list | std::views::transform([](int x) { return x * 10L; }));
+    EXPECT_EQ(widened.size(), 5);
+    EXPECT_EQ(widened[2], 30L);
+
+    ctm::vector<std::string> strings(ctm::from_range, std::views::iota(0, 3) |
+        std::views::transform([](int x) { return std::string(20, static_cast<char>('a' + x)); }));
+    EXPECT_EQ(strings[2], std::string(20, 'c'));
+}
+
+TEST(Ranges, AppendAndAssign)
+{
+    ctm::vector<int> vec{1, 2};
+    std::array<int, 3> more{3, 4, 5};
+    vec.append_range(more);
+    EXPECT_EQ(vec.size(), 5);
+    EXPECT_EQ(vec.capacity(), 8);
+
+    // appending the vector to itself copies the source before growing
+    vec.append_range(vec);
+    EXPECT_EQ(vec.size(), 10);
+    EXPECT_EQ(vec[9], 5);
+    EXPECT_EQ(vec[5], 1);
+
+    vec.assign_range(std::views::iota(7, 9));
+    EXPECT_EQ(vec.size(), 2);
+    EXPECT_EQ(vec[0], 7);
+    EXPECT_EQ(vec[1], 8);
+
+    // unsized: filter grows geometrically
+    vec.append_range(std::views::iota(0, 100) | std::views::filter([](int x) { return x % 10 == 0; }));
+    EXPECT_EQ(vec.size(), 12);
+    EXPECT_EQ(vec.back(), 90);
+}
+
+TEST(Ranges, ArraysAndSelfSpans)
+{
+    // C arrays have no member begin/end
+    int raw[3] = {4, 5, 6};
+    ctm::vector<int> vec(ctm::from_range, raw);
+    EXPECT_EQ(vec.size(), 3);
+    vec.append_range(raw);
+    EXPECT_EQ(vec.size(), 6);
+    EXPECT_EQ(vec[5], 6);
+    vec.assign_range(raw);
+    EXPECT_EQ(vec.size(), 3);
+    EXPECT_EQ(ctm::to_vector(raw)[1], 5);
+
+    // a span over the vector's own storage survives the reallocation
+    ctm::vector<std::string> words{"a", "b", "c", "d"};
+    EXPECT_EQ(words.size(), words.capacity());
+    words.append_range(std::span<const std::string>(words.data() + 1, 3));
+    EXPECT_EQ(words.size(), 7);
+    EXPECT_EQ(words[4], "b");
+    EXPECT_EQ(words[6], "d");
+}
+
+TEST(Ranges, ToVector)
+{
+    ctm::vector<int> input{5, 1, 4, 2, 3};
+
+    auto squares = input | std::views::transform([](int x) { return x * x; }) | ctm::to_vector();
+    static_assert(std::is_same_v<decltype(squares), ctm::vector<int>>);
+    EXPECT_EQ(squares.size(), 5);
+    EXPECT_EQ(squares.capacity(), 8);
+    EXPECT_EQ(squares[0], 25);
+
+    auto evens = ctm::to_vector(input | std::views::filter([](int x) { return x % 2 == 0; }));
+    EXPECT_EQ(evens.size(), 2);
+    EXPECT_EQ(evens[0], 4);
+    EXPECT_EQ(evens[1], 2);
+
+    constexpr int sum = []()
+    {
+        ctm::vector<int> v = std::views::iota(1, 5) | ctm::to_vector();
+        int total = 0;
+        for (int x : v)
+        {
+            total += x;
+        }
+        return total;
+    }();
+    EXPECT_EQ(sum, 10);
+}
+
+namespace
+{
+
+template <typename T>
+ctm::vector<T> random_values(std::size_t n, std::uint64_t seed)
+{
+    ctm::vector<T> values;
+    values.reserve(n);
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        values.push_back(static_cast<T>(static_cast<std::int64_t>(seed) >> 20));
+    }
+    return values;
+}
+
+};
+
+TEST(Sort, RadixIntegersAndFloats)
+{
+    ctm::thread_pool pool(4);
+
+    ctm::vector<std::uint64_t> u = random_values<std::uint64_t>(300000, 1);
+    ctm::vector<std::uint64_t> expected_u(u);
+    std::sort(expected_u.begin(), expected_u.end());
+    ctm::sort(u, pool);
+    EXPECT_TRUE(std::equal(u.begin(), u.end(), expected_u.begin(), expected_u.end()));
+
+    ctm::vector<int> small_range = random_values<int>(5000, 2);
+    for (int& x : small_range)
+    {
+        x %= 100;
+    }
+    ctm::vector<int> expected_i(small_range);
+    std::sort(expected_i.begin(), expected_i.end());
+    ctm::sort(small_range);
+    EXPECT_TRUE(std::equal(small_range.begin(), small_range.end(), expected_i.begin(), expected_i.end()));
+
+    ctm::vector<double> d = random_values<double>(200000, 3);
+    d[0] = -0.5;
+    d[1] = 0.0;
+    d[2] = std::numeric_limits<double>::infinity();
+    d[3] = -std::numeric_limits<double>::infinity();
+    ctm::vector<double> expected_d(d);
+    std::sort(expected_d.begin(), expected_d.end());
+    ctm::sort(d, pool);
+    EXPECT_TRUE(std::equal(d.begin(), d.end(), expected_d.begin(), expected_d.end()));
+    EXPECT_EQ(d.front(), -std::numeric_limits<double>::infinity());
+}
+
+TEST(Sort, MergeSortWithComparator)
+{
+    ctm::thread_pool pool(3);
+    ctm::vector<std::int64_t> raw = random_values<std::int64_t>(250001, 4);
+    ctm::vector<std::string> strings;
+
+    for (std::int64_t x : raw)
+    {
+        strings.push_back(std::to_string(x % 100000));
+    }
+
+    ctm::vector<std::string> expected(strings);
+    std::sort(expected.begin(), expected.end(), std::greater<>());
+    ctm::sort(strings, std::greater<>(), pool);
+    EXPECT_TRUE(std::equal(strings.begin(), strings.end(), expected.begin(), expected.end()));
+
+    ctm::vector<S> few{S{3, 0.0, "c"}, S{1, 0.0, "a"}, S{2, 0.0, "b"}};
+    ctm::sort(few, [](const S& x, const S& y) { return x.a_ < y.a_; });
+    EXPECT_EQ(few[0].c_, "a");
+    EXPECT_EQ(few[2].c_, "c");
+}
 
+TEST(Sort, ByKeyIsStable)
+{
+    ctm::thread_pool pool(2);
+    ctm::vector<S> records;
+
+    for (int i = 0; i < 100000; ++i)
+    {
+        records.push_back(S{(i * 7919) % 13 - 6, static_cast<double>(i), "r"});
+    }
+
+    ctm::sort_by_key(records, [](const S& s) { return s.a_; }, pool);
+
+    for (std::size_t i = 1; i < records.size(); ++i)
+    {
+        ASSERT_LE(records[i - 1].a_, records[i].a_);
+
+        if (records[i - 1].a_ == records[i].a_)
+        {
+            ASSERT_LT(records[i - 1].b_, records[i].b_);
+        }
+    }
+    EXPECT_EQ(records.front().a_, -6);
+}
+
+TEST(ThreadPool, ParallelFor)
+{
+    ctm::thread_pool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+
+    ctm::vector<int> hits(1000, 0);
+    pool.parallel_for(hits.size(), [&hits](std::size_t i) { hits[i] += 1; });
+    EXPECT_EQ(std::count(hits.begin(), hits.end(), 1), 1000);
+
+    EXPECT_THROW([&pool](){pool.parallel_for(10, [](std::size_t i)
+    {
+        if (i == 7)
+        {
+            throw std::runtime_error("task failed");
+        }
+    });}(), std::runtime_error);
+
+    // nested calls run inline
+    std::atomic<int> total{0};
+    pool.parallel_for(4, [&pool, &total](std::size_t)
+    {
+        pool.parallel_for(4, [&total](std::size_t) { total += 1; });
+    });
+    EXPECT_EQ(total.load(), 16);
+}
+
+
+#if defined(__linux__)
+namespace
+{
+
+std::string shm_test_name(const char* tag)
+{
+    return "/ctm_test_" + std::string(tag) + "_" + std::to_string(getpid());
+}
+
+};
+
+TEST(ShmVector, SharedBetweenMappings)
+{
+    const std::string name = shm_test_name("mappings");
+    ctm::shm_vector<long>::remove(name);
+    ctm::shm_vector<long> writer = ctm::shm_vector<long>::create(name, 1 << 20);
+    ctm::shm_vector<long> reader = ctm::shm_vector<long>::open(name);
+
+    // two mappings of one segment, at different addresses
+    EXPECT_NE(writer.data(), reader.data());
+    EXPECT_TRUE(reader.empty());
+    EXPECT_FALSE(reader.writable());
+
+    for (long i = 0; i < 5000; ++i)
+    {
+        writer.push_back(i);
+    }
+
+    // growth is visible without remapping
+    EXPECT_EQ(reader.size(), 5000);
+    EXPECT_GE(reader.capacity(), 5000);
+    EXPECT_EQ(reader[4999], 4999);
+    EXPECT_EQ(reader.at(10), 10);
+    EXPECT_EQ(std::accumulate(reader.begin(), reader.end(), 0L), 4999L * 5000 / 2);
+
+    writer.set(3, -3);
+    EXPECT_EQ(reader.read([](std::span<const long> values) { return values[3]; }), -3);
+
+    writer.resize(10);
+    EXPECT_EQ(reader.size(), 10);
+    EXPECT_THROW([&reader](){reader.at(10);}(), std::out_of_range);
+    EXPECT_THROW([&reader](){reader.push_back(1);}(), std::logic_error);
+    EXPECT_THROW([&writer](){writer.reserve(writer.max_capacity() + 1);}(), std::length_error);
+
+    EXPECT_TRUE(ctm::shm_vector<long>::remove(name));
+}
+
+TEST(ShmVector, OpenErrors)
+{
+    const std::string name = shm_test_name("errors");
+    ctm::shm_vector<int>::remove(name);
+    EXPECT_THROW([&name](){ctm::shm_vector<int>::open(name);}(), std::system_error);
+
+    ctm::shm_vector<int> writer = ctm::shm_vector<int>::create(name, 64);
+    EXPECT_THROW([&name](){ctm::shm_vector<int>::create(name, 64);}(), std::system_error);
+    EXPECT_THROW([&name](){ctm::shm_vector<double>::open(name);}(), std::runtime_error);
+    ctm::shm_vector<int>::remove(name);
+}
+
+TEST(ShmVector, UnfinishedSegment)
+{
+    // what a reader sees between the creator's shm_open and its header write
+    const std::string name = shm_test_name("unfinished");
+    ctm::shm_vector<int>::remove(name);
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    ASSERT_GE(fd, 0);
+
+    auto open_error = [&name]()
+    {
+        try
+        {
+            ctm::shm_vector<int>::open(name);
+        }
+        catch (const std::system_error& e)
+        {
+            return e.code();
+        }
+        return std::error_code();
+    };
+
+    EXPECT_EQ(open_error(), std::errc::resource_unavailable_try_again);
+    ASSERT_EQ(ftruncate(fd, 4096), 0);
+    EXPECT_EQ(open_error(), std::errc::resource_unavailable_try_again);
+
+    close(fd);
+    ctm::shm_vector<int>::remove(name);
+}
+
+TEST(ShmVector, FailedCreateLeavesNoSegment)
+{
+    const std::string name = shm_test_name("failed");
+    ctm::shm_vector<char>::remove(name);
+
+    // far more address space than a process has, so mmap fails
+    EXPECT_THROW([&name](){ctm::shm_vector<char>::create(name, std::size_t(1) << 62);}(), std::system_error);
+    EXPECT_FALSE(ctm::shm_vector<char>::remove(name));
+}
+
+TEST(ShmVector, SharedWithChildProcess)
+{
+    const std::string name = shm_test_name("fork");
+    ctm::shm_vector<int>::remove(name);
+    ctm::shm_vector<int> writer = ctm::shm_vector<int>::create(name, 1 << 16);
+    writer.resize(1000, 7);
+
+    const pid_t child = fork();
+    ASSERT_GE(child, 0);
+
+    if (child == 0)
+    {
+        // the child maps the segment itself, appends as the writer and exits
+        ctm::shm_vector<int> vec = ctm::shm_vector<int>::open(name, ctm::shm_access::read_write);
+        const bool seen = vec.size() == 1000 && vec[999] == 7;
+        vec.push_back(42);
+        _exit(seen ? 0 : 1);
+    }
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    EXPECT_EQ(writer.size(), 1001);
+    EXPECT_EQ(writer[1000], 42);
+    ctm::shm_vector<int>::remove(name);
+}
+#endif
+
+TEST(RcuVector, SnapshotsAndBatches)
+{
+    ctm::rcu_vector<int> routes{1, 2, 3};
+    EXPECT_EQ(routes.read().size(), 3);
+
+    auto before = routes.read();
+    routes.push_back(4);
+    routes.set(0, 10);
+    EXPECT_EQ(routes.version(), 2);
+
+    // an old snapshot is immutable and keeps its buffer alive
+    EXPECT_EQ(before.size(), 3);
+    EXPECT_EQ(before[0], 1);
+    EXPECT_GE(routes.retired_count(), 1);
+
+    auto after = routes.read();
+    const std::array<int, 4> expected{10, 2, 3, 4};
+    EXPECT_TRUE(std::equal(after.begin(), after.end(), expected.begin(), expected.end()));
+
+    // many changes, one publish
+    routes.update([](ctm::vector<int>& values)
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            values.push_back(i);
+        }
+        values[1] = 20;
+    });
+    EXPECT_EQ(routes.version(), 3);
+    EXPECT_EQ(routes.read().size(), 104);
+
+    {
+        auto batch = routes.write();
+        batch->clear();
+        batch->push_back(7);
+    }
+    EXPECT_EQ(routes.version(), 3);
+
+    {
+        auto batch = routes.write();
+        batch->clear();
+        batch->push_back(7);
+        batch.commit();
+    }
+    EXPECT_EQ(routes.version(), 4);
+    EXPECT_EQ(routes.read()[0], 7);
+
+    EXPECT_THROW([&routes](){routes.set(5, 1);}(), std::out_of_range);
+    EXPECT_EQ(routes.version(), 4);
+
+    // once the snapshots are gone everything retired can be freed
+    EXPECT_EQ(after[0], 10);
+    {
+        auto drop_before = std::move(before);
+        auto drop_after = std::move(after);
+    }
+    routes.reclaim();
+    EXPECT_EQ(routes.retired_count(), 0);
+}
+
+TEST(RcuVector, ConcurrentReaders)
+{
+    // every published buffer holds size() copies of one value
+    ctm::rcu_vector<int> table(ctm::vector<int>(64, 0));
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::vector<std::thread> readers;
+
+    for (int r = 0; r < 4; ++r)
+    {
+        readers.emplace_back([&table, &done, &torn]()
+        {
+            while (!done.load())
+            {
+                auto snap = table.read();
+
+                if (std::count(snap.begin(), snap.end(), snap[0]) != static_cast<long>(snap.size()))
+                {
+                    ++torn;
+                }
+            }
+        });
+    }
+
+    for (int v = 1; v <= 2000; ++v)
+    {
+        table.update([v](ctm::vector<int>& values)
+        {
+            std::fill(values.begin(), values.end(), v);
+            values.push_back(v);
+        });
+    }
+
+    done = true;
+
+    for (std::thread& reader : readers)
+    {
+        reader.join();
+    }
+
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_EQ(table.read().size(), 2064);
+    table.reclaim();
+    EXPECT_EQ(table.retired_count(), 0);
+}
+
+TEST(BatchedAppend, AppendN)
+{
+    ctm::vector<int> vec{1, 2, 3};
+    int next = 4;
+    vec.append_n(10, [&next]() { return next++; });
+    EXPECT_EQ(vec.size(), 13);
+    EXPECT_EQ(vec.capacity(), 16);
+
+    for (int i = 0; i < 13; ++i)
+    {
+        EXPECT_EQ(vec[i], i + 1);
+    }
+
+    vec.append_n(0, []() { return 0; });
+    EXPECT_EQ(vec.size(), 13);
+
+    // a throwing generator keeps what it already produced
+    int produced = 0;
+    auto decode = [&produced]()
+    {
+        if (produced == 2)
+        {
+            throw std::runtime_error("decode failed");
+        }
+        return 100 + produced++;
+    };
+    EXPECT_THROW([&](){vec.append_n(5, decode);}(), std::runtime_error);
+    EXPECT_EQ(vec.size(), 15);
+    EXPECT_EQ(vec.back(), 101);
+}
+
+TEST(BatchedAppend, EmplaceBackN)
+{
+    ctm::vector<std::pair<int, std::string>> records;
+    records.emplace_back_n(3, 1, "x");
+    EXPECT_EQ(records.size(), 3);
+    EXPECT_EQ(records.capacity(), 4);
+    EXPECT_EQ(records[2].first, 1);
+    EXPECT_EQ(records[2].second, "x");
+
+    ctm::vector<std::string> words;
+    words.emplace_back_n(5, 3, 'z');
+    EXPECT_EQ(words[4], "zzz");
+}
+
+TEST(BatchedAppend, PushBackUnchecked)
+{
+    ctm::vector<std::string> vec;
+    vec.reserve(4);
+    std::string s = "moved";
+
+    vec.push_back_unchecked("a");
+    vec.push_back_unchecked(std::move(s));
+    EXPECT_EQ(vec.size(), 2);
+    EXPECT_EQ(vec.capacity(), 4);
+    EXPECT_EQ(vec[1], "moved");
+}
 
+TEST(PushBack, MovesAndAliases)
+{
+    // rvalues are moved, so move-only types can be pushed
+    ctm::vector<std::unique_ptr<int>> owners;
 
+    for (int i = 0; i < 5; ++i)
+    {
+        owners.push_back(std::make_unique<int>(i));
+    }
+    owners.emplace_back(new int(5));
+    EXPECT_EQ(*owners[5], 5);
+    EXPECT_EQ(owners.capacity(), 8);
+
+    // pushing an element of the vector itself survives the reallocation
+    ctm::vector<std::string> words{"alpha", "beta", "gamma", "delta"};
+    EXPECT_EQ(words.size(), words.capacity());
+    words.push_back(words[0]);
+    words.emplace_back(words[1]);
+    EXPECT_EQ(words[4], "alpha");
+    EXPECT_EQ(words[5], "beta");
+}
\ No newline at end of file